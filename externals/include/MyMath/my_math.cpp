@@ -642,101 +642,134 @@ matrix::Matrix<4, 4> geometry3D::getTransformMatrix(const Vector3& position, con
     }
 }
 
-// Returns an array of vertices that result of the clipping of the given triangle against the given frustum.
-std::vector<geometry3D::Triangle3> geometry3D::clipHomogeneousTriangle(const geometry3D::Triangle3& triangle, float vertexAbsW[3])
+#ifdef MY_MATRIX_SSE
+// Transforms 4 points (12 packed floats) by the broadcast elements of a 4x4 matrix, and writes them as 4 Vector4.
+static inline void transform4Points(const __m128 m[4][4], const float* in, float* out)
 {
-    // TODO: fix this.
-    //* https://www.youtube.com/watch?v=VMD7fsCYO9o&t=432s&ab_channel=thebennybox
-    //* https://www.youtube.com/watch?v=og7hOFypKpQ&ab_channel=UCDavisAcademics
-    //* https://www.cubic.org/docs/3dclip.htm#ma4
+    // Load the points (x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3) and deinterleave them.
+    __m128 a = _mm_loadu_ps(in), b = _mm_loadu_ps(in + 4), c = _mm_loadu_ps(in + 8);
+    __m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,0,0,2)), _MM_SHUFFLE(3,0,3,0));
+    __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0));
+    __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2)), c, _MM_SHUFFLE(3,0,2,0));
 
-    std::vector<Vertex> vertices;
-    for (int i = 0; i < 3; i++)
-        vertices.push_back(*((&triangle.a) + i));
-    
-    std::vector<Vertex> clippedVertices;
+    // Compute each output coordinate of the 4 points at once.
+    __m128 result[4];
+    for (int j = 0; j < 4; j++)
+        result[j] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m[0][j]), _mm_mul_ps(y, m[1][j])), _mm_mul_ps(z, m[2][j])), m[3][j]);
 
-    // Loop over the vertices.
-    for (int i = 0; i < 3; i++)
+    // Interleave the results back to x y z w.
+    _MM_TRANSPOSE4_PS(result[0], result[1], result[2], result[3]);
+    for (int j = 0; j < 4; j++)
+        _mm_storeu_ps(out + 4 * j, result[j]);
+}
+#endif
+
+void geometry3D::transformPoints(const matrix::Matrix<4, 4>& mat, const Vector3* in, Vector4* out, size_t n)
+{
+#ifdef MY_MATRIX_SSE
+    static_assert(sizeof(Vector3) == 3 * sizeof(float) && sizeof(Vector4) == 4 * sizeof(float));
+
+    // Broadcast each element of the matrix.
+    __m128 m[4][4];
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++)
+            m[i][j] = _mm_set1_ps(mat[i][j]);
+
+    // Transform the points 4 at a time.
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        transform4Points(m, &in[i].x, &out[i].x);
+
+    // Pad the remaining points.
+    if (i < n)
     {
-        // If the current vertex is between -w and w.
-        if (-vertexAbsW[i] <= vertices[i].pos.x && vertices[i].pos.x <= vertexAbsW[i] &&
-            -vertexAbsW[i] <= vertices[i].pos.y && vertices[i].pos.y <= vertexAbsW[i] &&
-            -vertexAbsW[i] <= vertices[i].pos.z && vertices[i].pos.z <= vertexAbsW[i])
-        {
-            // Add the vertex to the list.
-            clippedVertices.push_back(vertices[i]);
-        }
+        Vector3 tailIn [4];
+        Vector4 tailOut[4];
+        for (size_t j = i; j < n; j++) tailIn[j - i] = in[j];
+        transform4Points(m, &tailIn[0].x, &tailOut[0].x);
+        for (size_t j = i; j < n; j++) out[j] = tailOut[j - i];
+    }
+#else
+    for (size_t i = 0; i < n; i++)
+        out[i] = Vector4(in[i], 1) * mat;
+#endif
+}
 
-        // If it is not between -w and w.
-        else
-        {
-            // Get the current, previous and next position and w.
-            float   curW    = vertexAbsW[i];
-            Vector3 curPos  = vertices[i].pos;
-            float   prevW   = vertexAbsW[(i == 0 ? 2 : i-1)];
-            Vector3 prevPos = vertices[(i == 0 ? 2 : i-1)].pos;
-            float   nextW   = vertexAbsW[(i+1)%3];
-            Vector3 nextPos = vertices[(i+1)%3].pos;
+// Signed distances to the planes of the clip volume (positive inside).
+static float clipPlaneDistance(const Vector4& pos, const int& plane, const float& xyExtent)
+{
+    switch (plane)
+    {
+    case 0:  return pos.z;                    // Near.
+    case 1:  return pos.w - pos.z;            // Far.
+    case 2:  return pos.w * xyExtent + pos.x; // Left.
+    case 3:  return pos.w * xyExtent - pos.x; // Right.
+    case 4:  return pos.w * xyExtent + pos.y; // Bottom.
+    default: return pos.w * xyExtent - pos.y; // Top.
+    }
+}
 
-            {
-                // Compute the lerping factors.
-                float xFactor = (prevW - prevPos.x) / ((prevW - prevPos.x) - (curW - curPos.x));
-                // float yFactor = (prevW - prevPos.y) / ((prevW - prevPos.y) - (curW - curPos.y));
-                // float zFactor = (prevW - prevPos.z) / ((prevW - prevPos.z) - (curW - curPos.z));
-
-                printf("Lerp factors: %.2f\n", xFactor);
-
-                // Lerp the vertice's coords.
-                float xLerp = arithmetic::lerp(xFactor, prevPos.x, curPos.x);
-                // float yLerp = arithmetic::lerp(yFactor, prevPos.y, curPos.y);
-                // float zLerp = arithmetic::lerp(zFactor, prevPos.z, curPos.z);
-
-                // Create a new vertex.
-                Vertex lerpVertex = {
-                    { xLerp, curPos.y, curPos.z },
-                    vertices[i].normal,
-                    vertices[i].color,
-                    vertices[i].uv
-                };
+bool geometry3D::isInsideClipVolume(const Vector4& pos, const float& xyExtent)
+{
+    for (int plane = 0; plane < 6; plane++)
+        if (clipPlaneDistance(pos, plane, xyExtent) < 0)
+            return false;
+    return true;
+}
 
-                // Add the vertex to the list.
-                clippedVertices.push_back(lerpVertex);
-            }
+int geometry3D::clipHomogeneousTriangle(const Vector4 triangle[3], ClipVertex output[MAX_CLIPPED_VERTICES], const float& xyExtent)
+{
+    // Sutherland-Hodgman: clip the polygon against each plane in turn, ping-ponging between two buffers.
+    // The near plane comes first so that w is positive for the other planes.
+    ClipVertex  buffer[MAX_CLIPPED_VERTICES];
+    ClipVertex* input = buffer;
+    ClipVertex* clipped = output;
+
+    int count = 3;
+    input[0] = { triangle[0], { 1, 0, 0 } };
+    input[1] = { triangle[1], { 0, 1, 0 } };
+    input[2] = { triangle[2], { 0, 0, 1 } };
+
+    for (int plane = 0; plane < 6; plane++)
+    {
+        int clippedCount = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const ClipVertex& cur  = input[i];
+            const ClipVertex& next = input[(i + 1) % count];
+            float curDist  = clipPlaneDistance(cur.pos,  plane, xyExtent);
+            float nextDist = clipPlaneDistance(next.pos, plane, xyExtent);
 
+            // Keep the vertices that are inside.
+            if (curDist >= 0)
+                clipped[clippedCount++] = cur;
+
+            // Add the intersection of the edges that cross the plane.
+            if ((curDist >= 0) != (nextDist >= 0))
             {
-                // Compute the lerping factors.
-                float xFactor = (nextW - nextPos.x) / ((nextW - nextPos.x) - (curW - curPos.x));
-                // float yFactor = (nextW - nextPos.y) / ((nextW - nextPos.y) - (curW - curPos.y));
-                // float zFactor = (nextW - nextPos.z) / ((nextW - nextPos.z) - (curW - curPos.z));
-
-                // Lerp the vertice's coords.
-                float xLerp = arithmetic::lerp(xFactor, nextPos.x, curPos.x);
-                // float yLerp = arithmetic::lerp(yFactor, nextPos.y, curPos.y);
-                // float zLerp = arithmetic::lerp(zFactor, nextPos.z, curPos.z);
-
-                // Create a new vertex.
-                Vertex lerpVertex = {
-                    { xLerp, curPos.y, curPos.z },
-                    vertices[i].normal,
-                    vertices[i].color,
-                    vertices[i].uv
+                float t = curDist / (curDist - nextDist);
+                clipped[clippedCount++] = {
+                    cur.pos     + (next.pos     - cur.pos)     * t,
+                    cur.weights + (next.weights - cur.weights) * t,
                 };
-
-                // Add the vertex to the list.
-                clippedVertices.push_back(lerpVertex);
             }
         }
-    }
 
-    // Create the output triangles.
-    std::vector<Triangle3> clippedTriangles;
-    for (int i = 1; i < (int)clippedVertices.size() - 1; i++)
-    {
-        clippedTriangles.push_back({ clippedVertices[0], clippedVertices[i], clippedVertices[i+1] });
+        count = clippedCount;
+        if (count < 3)
+            return 0;
+
+        // The polygon clipped against this plane is the input of the next one.
+        ClipVertex* temp = input;
+        input   = clipped;
+        clipped = temp;
     }
 
-    return clippedTriangles;
+    // After an even number of planes, the result is back in the local buffer.
+    if (input != output)
+        for (int i = 0; i < count; i++)
+            output[i] = input[i];
+    return count;
 }
 
 
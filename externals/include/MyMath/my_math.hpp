@@ -421,6 +421,9 @@ namespace geometry3D
     matrix::Matrix<4, 4> getZRotationMatrix  (float angle);
     matrix::Matrix<4, 4> getTransformMatrix  (const geometry3D::Vector3& position, const geometry3D::Vector3& rotation, const geometry3D::Vector3& scale, const bool& reverse = false);
 
+    // Transforms n points (with w = 1) by the given matrix, writing the results to out. Points are processed 4 at a time in SoA form.
+    void transformPoints(const matrix::Matrix<4, 4>& mat, const Vector3* in, Vector4* out, size_t n);
+
     // Vector class that holds values for x, y and z (3 dimensions).
     class Vector3
     {
@@ -621,8 +624,22 @@ namespace geometry3D
         geometry3D::Plane3 far;
     };
 
-    // Returns an array of vertices that result of the clipping of the given triangle against the given frustum.
-    std::vector<geometry3D::Triangle3> clipHomogeneousTriangle(const geometry3D::Triangle3& triangle, float pointAbsW[3]);
+    // Maximum number of vertices of a triangle clipped against the 6 planes of the clip volume.
+    #define MAX_CLIPPED_VERTICES 9
+
+    // Vertex of a clipped polygon: its clip space position and its barycentric weights in the source triangle.
+    struct ClipVertex
+    {
+        Vector4 pos;
+        Vector3 weights;
+    };
+
+    // Returns true if the given clip space position is inside the clip volume (0 <= z <= w, -xyExtent*w <= x,y <= xyExtent*w).
+    bool isInsideClipVolume(const Vector4& pos, const float& xyExtent = 1);
+
+    // Clips the given clip space triangle against the clip volume.
+    // Writes the resulting convex polygon in the given buffer and returns its vertex count (0 or 3 to MAX_CLIPPED_VERTICES).
+    int clipHomogeneousTriangle(const Vector4 triangle[3], ClipVertex output[MAX_CLIPPED_VERTICES], const float& xyExtent = 1);
 
     // Segment3 structure that holds values for the starting point and the end point.
     class Segment3
@@ -426,6 +426,11 @@ inline void Vector4::operator/=<Vector4>(const Vector4& val)
 template <>
 inline Vector4 Vector4::operator*<Matrix<4,4>>(const Matrix<4,4>& val) const
 {
+#ifdef MY_MATRIX_SSE
+    Vector4 result;
+    _mm_storeu_ps(&result.x, matrix::sse::mulVec4(_mm_loadu_ps(&x), val.m));
+    return result;
+#else
     return Vector4
     (
         x * val[0][0] + y * val[1][0] + z * val[2][0] + w * val[3][0],
@@ -433,6 +438,7 @@ inline Vector4 Vector4::operator*<Matrix<4,4>>(const Matrix<4,4>& val) const
         x * val[0][2] + y * val[1][2] + z * val[2][2] + w * val[3][2],
         x * val[0][3] + y * val[1][3] + z * val[2][3] + w * val[3][3]
     );
+#endif
 }
 
 // ---------- COLLISIONS 2D ---------- //
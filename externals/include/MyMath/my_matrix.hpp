@@ -1,10 +1,16 @@
 #pragma once
 
 #include <cstdio>
+#include <cstring>
 #include <string>
 #include <sstream>
 #include "my_math.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#define MY_MATRIX_SSE
+#include <emmintrin.h>
+#endif
+
 namespace matrix
 {
 
@@ -17,18 +23,108 @@ typedef Matrix<2,2> Mat2;
 typedef Matrix<3,3> Mat3;
 typedef Matrix<4,4> Mat4;
 
+// Tag for matrices that are about to be entirely overwritten (skips the zero-fill).
+struct Uninitialized {};
+
+#ifdef MY_MATRIX_SSE
+// SSE kernels of 4x4 matrices (rows must be 16-byte aligned).
+namespace sse
+{
+    // Returns the row vector _v multiplied by the matrix _m: _v.x * m[0] + _v.y * m[1] + _v.z * m[2] + _v.w * m[3].
+    inline __m128 mulVec4(const __m128& _v, const float _m[4][4])
+    {
+        __m128 result = _mm_mul_ps(_mm_shuffle_ps(_v, _v, _MM_SHUFFLE(0,0,0,0)), _mm_load_ps(_m[0]));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(_v, _v, _MM_SHUFFLE(1,1,1,1)), _mm_load_ps(_m[1])));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(_v, _v, _MM_SHUFFLE(2,2,2,2)), _mm_load_ps(_m[2])));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(_v, _v, _MM_SHUFFLE(3,3,3,3)), _mm_load_ps(_m[3])));
+        return result;
+    }
+
+    // Multiplies the matrices _a and _b (each row of the result is a row of _a multiplied by _b).
+    inline void mulMat4(const float _a[4][4], const float _b[4][4], float _result[4][4])
+    {
+        for (int i = 0; i < 4; i++)
+            _mm_store_ps(_result[i], mulVec4(_mm_load_ps(_a[i]), _b));
+    }
+
+    // 2x2 matrix products, on matrices stored as (m00, m01, m10, m11).
+    inline __m128 mat2Mul   (const __m128& _a, const __m128& _b) // A * B
+    {
+        return _mm_add_ps(_mm_mul_ps(_a, _mm_shuffle_ps(_b, _b, _MM_SHUFFLE(3,0,3,0))),
+                          _mm_mul_ps(_mm_shuffle_ps(_a, _a, _MM_SHUFFLE(2,3,0,1)), _mm_shuffle_ps(_b, _b, _MM_SHUFFLE(1,2,1,2))));
+    }
+    inline __m128 mat2AdjMul(const __m128& _a, const __m128& _b) // adj(A) * B
+    {
+        return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(_a, _a, _MM_SHUFFLE(0,0,3,3)), _b),
+                          _mm_mul_ps(_mm_shuffle_ps(_a, _a, _MM_SHUFFLE(2,2,1,1)), _mm_shuffle_ps(_b, _b, _MM_SHUFFLE(1,0,3,2))));
+    }
+    inline __m128 mat2MulAdj(const __m128& _a, const __m128& _b) // A * adj(B)
+    {
+        return _mm_sub_ps(_mm_mul_ps(_a, _mm_shuffle_ps(_b, _b, _MM_SHUFFLE(0,3,0,3))),
+                          _mm_mul_ps(_mm_shuffle_ps(_a, _a, _MM_SHUFFLE(2,3,0,1)), _mm_shuffle_ps(_b, _b, _MM_SHUFFLE(1,2,1,2))));
+    }
+
+    // Inverts the matrix _m blockwise, with its 4 2x2 sub-matrices A B / C D.
+    inline void invMat4(const float _m[4][4], float _result[4][4])
+    {
+        __m128 r0 = _mm_load_ps(_m[0]), r1 = _mm_load_ps(_m[1]), r2 = _mm_load_ps(_m[2]), r3 = _mm_load_ps(_m[3]);
+
+        // Sub-matrices.
+        __m128 A = _mm_movelh_ps(r0, r1);
+        __m128 B = _mm_movehl_ps(r1, r0);
+        __m128 C = _mm_movelh_ps(r2, r3);
+        __m128 D = _mm_movehl_ps(r3, r2);
+
+        // Determinants of the sub-matrices (|A|, |B|, |C|, |D|).
+        __m128 detSub = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2,0,2,0)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3,1,3,1))),
+                                   _mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3,1,3,1)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2,0,2,0))));
+        __m128 detA = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(0,0,0,0));
+        __m128 detB = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(1,1,1,1));
+        __m128 detC = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(2,2,2,2));
+        __m128 detD = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(3,3,3,3));
+
+        // Adjugates of the inverse's blocks: X = |D|A - B(adj(D)C), W = |A|D - C(adj(A)B), Y = |B|C - D adj(adj(A)B), Z = |C|B - A adj(adj(D)C).
+        __m128 DC = mat2AdjMul(D, C);
+        __m128 AB = mat2AdjMul(A, B);
+        __m128 X  = _mm_sub_ps(_mm_mul_ps(detD, A), mat2Mul(B, DC));
+        __m128 W  = _mm_sub_ps(_mm_mul_ps(detA, D), mat2Mul(C, AB));
+        __m128 Y  = _mm_sub_ps(_mm_mul_ps(detB, C), mat2MulAdj(D, AB));
+        __m128 Z  = _mm_sub_ps(_mm_mul_ps(detC, B), mat2MulAdj(A, DC));
+
+        // Determinant of the matrix: |A||D| + |B||C| - tr(adj(A)B adj(D)C).
+        __m128 trace = _mm_mul_ps(AB, _mm_shuffle_ps(DC, DC, _MM_SHUFFLE(3,1,2,0)));
+        trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, _MM_SHUFFLE(2,3,0,1)));
+        trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, _MM_SHUFFLE(1,0,3,2)));
+        __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), trace);
+
+        // Divide by the determinant, with the signs of the 2x2 adjugates.
+        __m128 invDet = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), detM);
+        X = _mm_mul_ps(X, invDet);
+        Y = _mm_mul_ps(Y, invDet);
+        Z = _mm_mul_ps(Z, invDet);
+        W = _mm_mul_ps(W, invDet);
+
+        // Take the adjugates of the blocks while storing them.
+        _mm_store_ps(_result[0], _mm_shuffle_ps(X, Y, _MM_SHUFFLE(1,3,1,3)));
+        _mm_store_ps(_result[1], _mm_shuffle_ps(X, Y, _MM_SHUFFLE(0,2,0,2)));
+        _mm_store_ps(_result[2], _mm_shuffle_ps(Z, W, _MM_SHUFFLE(1,3,1,3)));
+        _mm_store_ps(_result[3], _mm_shuffle_ps(Z, W, _MM_SHUFFLE(0,2,0,2)));
+    }
+}
+#endif
+
 // Matrix class.
 template<int R, int C>
 class Matrix
 {
     public:
         // ------- Members ------ //
-        float m[R][C];
+        alignas((R == 4 && C == 4) ? 16 : alignof(float)) float m[R][C]; // 4x4 matrices are aligned for SSE.
 
         // ----- Constructors & Destructor ----- //
         Matrix(bool identity = false) 
         { 
-            assert(R >= 2 && C >= 2);
+            static_assert(R >= 2 && C >= 2);
 
             if (!identity)
             {
@@ -47,18 +143,14 @@ class Matrix
             }
         }
 
-        Matrix(const Matrix<R,C>& matrix)
-        {
-            assert(R >= 2 && C >= 2);
-            for (int i = 0; i < R; i++)
-                for (int j = 0; j < C; j++)
-                    m[i][j] = matrix[i][j];
-        }
+        Matrix(const Matrix<R,C>& matrix) = default;
+
+        Matrix(Uninitialized) { static_assert(R >= 2 && C >= 2); }
 
         //? NOTE: Only for Matrix 2X2.
         Matrix(const float& a, const float& b, const float& c, const float& d)
         {
-            assert(R >= 2 && C >= 2);
+            static_assert(R >= 2 && C >= 2);
             m[0][0] = a; m[0][1] = b;
             m[1][0] = c; m[1][1] = d;
         }
@@ -68,7 +160,7 @@ class Matrix
                const float& d, const float& e, const float& f,
                const float& g, const float& h, const float& i)
         {
-            assert(R >= 3 && C >= 3);
+            static_assert(R >= 3 && C >= 3);
             m[0][0] = a; m[0][1] = b; m[0][2] = c;
             m[1][0] = d; m[1][1] = e; m[1][2] = f;
             m[2][0] = g; m[2][1] = h; m[2][2] = i;
@@ -80,7 +172,7 @@ class Matrix
                 const float& i, const float& j, const float& k, const float& l,
                 const float& M, const float& n, const float& o, const float& p)
         {
-            assert(R >= 4 && C >= 4);
+            static_assert(R >= 4 && C >= 4);
             m[0][0] = a; m[0][1] = b; m[0][2] = c; m[0][3] = d;
             m[1][0] = e; m[1][1] = f; m[1][2] = g; m[1][3] = h;
             m[2][0] = i; m[2][1] = j; m[2][2] = k; m[2][3] = l;
@@ -90,7 +182,7 @@ class Matrix
         //? NOTE: Only for Matrix 4x4 (from 2x2 matrices).
         Matrix(const Mat2& a, const Mat2& b, const Mat2& c, const Mat2& d)
         {
-            assert(R >= 4 && C >= 4);
+            static_assert(R >= 4 && C >= 4);
             m[0][0] = a[0][0]; m[0][1] = a[0][1]; m[0][2] = b[0][0]; m[0][3] = b[0][1];
             m[1][0] = a[1][0]; m[1][1] = a[1][1]; m[1][2] = b[1][0]; m[1][3] = b[1][1];
             m[2][0] = c[0][0]; m[2][1] = c[0][1]; m[2][2] = d[0][0]; m[2][3] = d[0][1];
@@ -100,7 +192,7 @@ class Matrix
         //? NOTE: For > n  matrixes.
         Matrix(const float matrix[R][C])
         {
-            assert(R > 4 && C > 4);
+            static_assert(R > 4 && C > 4);
             for (int i = 0; i < R; i++)
                 for (int j = 0; j < C; j++)
                     m[i][j] = matrix[i][j];
@@ -120,9 +212,7 @@ class Matrix
             if (&matrix == this) return *this;
             
             // Matrix content copy
-            for (int i = 0; i < R; i++) 
-                for (int j = 0; j < C; j++)
-                    m[i][j] = matrix[i][j];
+            memcpy(m, matrix.m, sizeof(m));
             
             return *this;
         }
@@ -151,7 +241,7 @@ class Matrix
         template<int _R, int _C>
         Matrix<R,C> operator+(const Matrix<_R,_C>& matrix) const
         {
-            assert(R == _R && C == _C); // Matrix must have the same dimension
+            static_assert(R == _R && C == _C); // Matrix must have the same dimension
             Matrix<_R,_C> tmp;
             for(int i = 0; i < R; i++)
                 for(int j = 0; j < C; j++)
@@ -181,7 +271,7 @@ class Matrix
         template<int _R, int _C>
         Matrix<R,C> operator-(const Matrix<_R,_C>& matrix) const
         {
-            assert(R == _R && C == _C);
+            static_assert(R == _R && C == _C);
             Matrix<_R,_C> tmp;
             for (int i = 0; i < R; i++)
                 for (int j = 0; j < C; j++)
@@ -203,7 +293,17 @@ class Matrix
         template<int _R, int _C>
         Matrix<(R > _R ? R : _R),(C > _C ? C : _C)> operator*(const Matrix<_R,_C>& matrix) const
         {
-            assert(C == _R); // Size condition to calculate
+            static_assert(C == _R); // Size condition to calculate
+
+            // 4x4 matrices are multiplied with SSE.
+#ifdef MY_MATRIX_SSE
+            if constexpr (R == 4 && C == 4 && _C == 4)
+            {
+                Matrix<4,4> result(Uninitialized{});
+                sse::mulMat4(m, matrix.m, result.m);
+                return result;
+            }
+#endif
 
             Matrix<(R > _R ? R : _R),(C > _C ? C : _C)> result;
             for (int i = 0; i < R; i++)
@@ -237,7 +337,7 @@ class Matrix
         template<int _R, int _C>
         void operator+=(const Matrix<_R,_C>& matrix)
         {
-            assert(R == _R && C == _C);
+            static_assert(R == _R && C == _C);
             for (int i = 0; i < R; i++)
                 for (int j = 0; j < C; j++)
                     m[i][j] += matrix[i][j];
@@ -254,7 +354,7 @@ class Matrix
         template<int _R, int _C>
         void operator-=(const Matrix<_R,_C>& matrix)
         {
-            assert(R == _R && C == _C);
+            static_assert(R == _R && C == _C);
             for (int i = 0; i < R; i++)
                 for (int j = 0; j < C; j++)
                     m[i][j] -= matrix[i][j];
@@ -282,16 +382,16 @@ class Matrix
         // ----- Methods ----- //
 
         // Getters.
-        int getRows() { return R; }
-        int getColumns() { return C; }  
-        float getMatrixValue(int i, int j) { return m[i][j]; }
+        int getRows() const { return R; }
+        int getColumns() const { return C; }  
+        float getMatrixValue(int i, int j) const { return m[i][j]; }
 
         // Setters.
 
         // Arithmetic.
-        bool isSquare() { return R == C; }
+        bool isSquare() const { return R == C; }
 
-        bool isIdentity()
+        bool isIdentity() const
         {
             for (int i = 0; i < R; i++)
                 for (int j = 0; j < C; j++)
@@ -301,19 +401,19 @@ class Matrix
         }
 
         // Determinants.
-        float det2() 
+        float det2() const 
         { 
             return (m[0][0] * m[1][1]) - (m[0][1] * m[1][0]); 
         }
 
-        float det3()
+        float det3() const
         {
             return m[0][0] * (Mat2){m[1][1], m[1][2], m[2][1], m[2][2]}.det2() - 
                    m[0][1] * (Mat2){m[1][0], m[1][2], m[2][0], m[2][2]}.det2() + 
                    m[0][2] * (Mat2){m[1][0], m[1][1], m[2][0], m[2][1]}.det2();
         }
 
-        float det4()
+        float det4() const
         {
             Mat3 a(m[1][1], m[1][2], m[1][3], m[2][1], m[2][2], m[2][3], m[3][1], m[3][2], m[3][3]);
             Mat3 b(m[1][0], m[1][2], m[1][3], m[2][0], m[2][2], m[2][3], m[3][0], m[3][2], m[3][3]);
@@ -324,13 +424,13 @@ class Matrix
         }
 
         // Inverses.
-        Mat2 inv2()
+        Mat2 inv2() const
         {
             Mat2 val(m[1][1], -m[0][1], -m[1][0], m[0][0]);
             return val / val.det2();
         }
 
-        Mat3 inv3()
+        Mat3 inv3() const
         {
             Mat4 val(m[0][0], m[0][1], m[0][2], 0,
                      m[1][0], m[1][1], m[1][2], 0,
@@ -343,8 +443,14 @@ class Matrix
             return result;
         }
 
-        Mat4 inv4()
+        Mat4 inv4() const
         {
+#ifdef MY_MATRIX_SSE
+            static_assert(R == 4 && C == 4);
+            Mat4 result(Uninitialized{});
+            sse::invMat4(m, result.m);
+            return result;
+#else
             Mat2 a(m[0][0], m[0][1], m[1][0], m[1][1]);
             Mat2 b(m[0][2], m[0][3], m[1][2], m[1][3]);
             Mat2 c(m[2][0], m[2][1], m[3][0], m[3][1]);
@@ -357,10 +463,11 @@ class Matrix
             };
 
             return result;
+#endif
         }
 
         // Transposition.
-        Matrix<R, C> transpose()
+        Matrix<C, R> transpose() const
         {
             Matrix<C, R> result;
             for (int i = 0; i < R; i++)
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+#include <HeadlessApp.hpp>
+
+// Stages of a frame timed by the benchmark.
+//  - CLEAR:   framebuffer clear.
+//  - DRAW:    scene update (vertex processing, triangle setup and, with the immediate backend, rasterization).
+//  - FLUSH:   rasterization of the triangles binned by the tiled backend.
+//  - RESOLVE: de-tiling and resolve of the color buffer for display.
+//  - FRAME:   the whole frame.
+enum class BenchmarkStage : int { CLEAR, DRAW, FLUSH, RESOLVE, FRAME };
+#define BENCHMARK_STAGE_COUNT 5
+
+// Initialization structure of the benchmark: the frame size, frame count, scene and render state are
+// the headless app's, and the results are written as JSON to the output path ("-" for stdout).
+struct BenchmarkInit
+{
+    HeadlessInit render;
+
+    // Number of untimed frames rendered before the timed ones.
+    int warmupCount;
+
+    // Run every scene preset instead of only render.scene.
+    bool allScenes;
+};
+
+// Duration statistics of a stage, in milliseconds.
+struct StageStats
+{
+    double min, median, p99, mean;
+};
+
+// Results of the benchmark of one scene.
+struct SceneResults
+{
+    ScenePreset scene;
+    int         trianglesPerFrame;
+    StageStats  stages[BENCHMARK_STAGE_COUNT];
+    double      trianglesPerSecond;
+    double      pixelsPerSecond;
+};
+
+// Renders fixed scenes headlessly and reports the duration of each stage of their frames.
+class Benchmark
+{
+private:
+    BenchmarkInit init;
+
+    // Renders the frames of a scene and returns their statistics.
+    SceneResults runScene(const ScenePreset& _scene) const;
+
+    // Writes the results as JSON.
+    bool writeResults(const std::vector<SceneResults>& _results, const RasterKernel& _kernel) const;
+
+public:
+    Benchmark(const BenchmarkInit& _init);
+
+    // Runs the benchmark of the scenes and writes the results. Returns false if they couldn't be written.
+    bool run();
+};
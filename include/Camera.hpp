@@ -61,6 +61,8 @@ public:
     // Sets the rotation of the camera to match the lookAt matrix rotation.
     void setLookAtRotation();
 
+#ifndef HEADLESS
     // Misc.
     void showImGuiControls();
+#endif
 };
\ No newline at end of file
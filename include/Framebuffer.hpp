@@ -1,22 +1,109 @@
 #pragma once
 
+#include <array>
 #include <vector>
-#include <glad/gl.h>
+#include <cstdio>
+#include <cstdint>
 #include <my_math.hpp>
 
+#ifndef HEADLESS
+#include <glad/gl.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define FRAMEBUFFER_SSE
+#include <emmintrin.h>
+#endif
+
+// Storage format of the color buffer. Colors are converted from float when they are written.
+//  - RGBA8:    8 bits per channel, packed in a uint32_t (r in the lowest byte).
+//  - SRGB8_A8: same as RGBA8, with rgb encoded to sRGB.
+//  - RGBA32F:  4 floats per pixel, for HDR.
+enum class ColorFormat : int { RGBA8, SRGB8_A8, RGBA32F };
+#define COLOR_FORMAT_COUNT 3
+
+// Storage format of the depth buffer. Depths are converted from the pixels' view-space depth when they are tested and written.
+//  - FLOAT32:          the view-space depth (closer pixels have smaller values).
+//  - FLOAT32_REVERSED: near / depth, from 1 at the near plane to near / far at the far plane (closer pixels have greater values).
+//                      Floats are densest around 0, which makes up for the loss of precision of 1 / depth in the distance.
+//  - UNORM16:          the view-space depth remapped linearly from [near, far] to 16 bits (half the memory of the other formats).
+//  - UNORM24:          same as UNORM16 with 24 bits, stored in a uint32_t.
+enum class DepthFormat : int { FLOAT32, FLOAT32_REVERSED, UNORM16, UNORM24 };
+
+// Memory layout of the buffers.
+//  - LINEAR: row-major.
+//  - TILED:  square tiles of FRAMEBUFFER_TILE_SIZE pixels stored contiguously (row-major inside the tiles and between them),
+//            so that the pixels of a triangle share cache lines and pages. The color buffer is de-tiled only to be displayed.
+enum class FramebufferLayout : int { LINEAR, TILED };
+#define FRAMEBUFFER_TILE_SIZE 8
+
+// Buffers of a tile that still have to be filled with the clear values (see Framebuffer::prepareTile).
+#define TILE_CLEAR_COLOR 1
+#define TILE_CLEAR_DEPTH 2
+
+// Size of the linear -> sRGB encoding table.
+#define SRGB_ENCODE_SIZE 4096
+
 class Framebuffer
 {
 private:
     // Framebuffer size.
     int width = 0, height = 0;
 
+    // Format of the color and depth buffers.
+    ColorFormat colorFormat = ColorFormat::RGBA8;
+    DepthFormat depthFormat = DepthFormat::FLOAT32;
+
+    // Memory layout of the buffers, their number of tiles per row and their size (padded to whole tiles when tiled).
+    FramebufferLayout layout     = FramebufferLayout::LINEAR;
+    int               tilesX     = 0;
+    int               bufferSize = 0;
+
+    // Values of the last clear, and the depth range that depths are converted with.
+    float    depthNear        = 0.f;
+    float    depthFar         = 1.f;
+    float    invDepthRange    = 1.f;
+    Color    frameClearColor  = { 0.f, 0.f, 0.f, 1.f };
+    uint32_t packedClearColor = 0;
+
+    // Number of tiles per column, and the buffers of each tile that haven't been cleared yet (TILE_CLEAR_* flags).
+    // Clears are lazy: a tile is only filled when it is first drawn to, or when the frame is displayed.
+    int                  tilesY = 0;
+    std::vector<uint8_t> pendingClears;
+
+    // De-tiled copies of the color buffer, to be displayed.
+    std::vector<uint32_t> linearPackedColors;
+    std::vector<Color>    linearColors;
+
+#ifndef HEADLESS
     // OpenGL texture (in VRAM)
     GLuint colorTexture = 0;
+#endif
+
+    // sRGB conversion tables.
+    static const std::array<float,   256>              srgbToLinear;
+    static const std::array<uint8_t, SRGB_ENCODE_SIZE> linearToSRGB;
+
+    // Packs a color to the given 8-bit format.
+    template<ColorFormat FORMAT> static uint32_t packColor  (const Color& _color);
+    template<ColorFormat FORMAT> static Color    unpackColor(const uint32_t& _packed);
+
+    // Packs the color of the last clear to the current color format.
+    uint32_t packClearColor() const;
+
+    // Converts a view-space depth to the depth format's unsigned normalized value.
+    uint32_t depthToUnorm(const float& _depth, const uint32_t& _max) const;
+
+    // Fills the given buffers (TILE_CLEAR_* flags) of a tile with the clear values.
+    void fillTile(const int& _tile, const uint8_t& _buffers);
 
 public:
-    // In-RAM buffers.
-    std::vector<Color> colorBuffer;
-    std::vector<float> depthBuffer;
+    // In-RAM buffers (only one of the color buffers and one of the depth buffers are used, depending on the formats).
+    std::vector<uint32_t> packedColorBuffer; // RGBA8 and SRGB8_A8.
+    std::vector<Color>    colorBuffer;       // RGBA32F.
+    std::vector<float>    depthBuffer;       // FLOAT32 and FLOAT32_REVERSED.
+    std::vector<uint16_t> depthBuffer16;     // UNORM16.
+    std::vector<uint32_t> depthBuffer24;     // UNORM24.
 
     // Default color for the framebuffer.
     Color clearColor = { 0.f, 0.f, 0.f, 1.f };
@@ -25,14 +112,207 @@ public:
     Framebuffer(const int& _width, const int& _height);
     ~Framebuffer();
 
-    // Fill the framebuffer with the clear color.
-    void clear(const int& zFar);
+    // Fill the framebuffer with the clear color and the far depth. Only marks the tiles as cleared: see prepareTile.
+    // The depth range is the one that depths are converted with until the next clear.
+    void clear(const float& _zNear, const float& _zFar);
+
+    // Fills the tile of the given pixel with the clear values if it hasn't been drawn to since the last clear.
+    // Must be called before reading or writing the tile's pixels.
+    void prepareTile(const int& _x, const int& _y)
+    {
+        const int tile = (_y / FRAMEBUFFER_TILE_SIZE) * tilesX + _x / FRAMEBUFFER_TILE_SIZE;
+        if (pendingClears[tile] != 0)
+            fillTile(tile, pendingClears[tile]);
+    }
+
+    // Changes the color buffer's format and clears it.
+    void setColorFormat(const ColorFormat& _format);
+
+    // Changes the depth buffer's format and clears it.
+    void setDepthFormat(const DepthFormat& _format);
+
+    // Changes the buffers' memory layout and clears them.
+    void setLayout(const FramebufferLayout& _layout);
+
+    // Returns the buffer index of the pixel at the given coordinates.
+    // The pixels of a tile row (FRAMEBUFFER_TILE_SIZE pixels aligned on the tile grid) have consecutive indices in every layout.
+    int getIndex(const int& _x, const int& _y) const
+    {
+        if (layout == FramebufferLayout::LINEAR)
+            return _y * width + _x;
+
+        const int tileIndex = (_y / FRAMEBUFFER_TILE_SIZE) * tilesX + _x / FRAMEBUFFER_TILE_SIZE;
+        return tileIndex * FRAMEBUFFER_TILE_SIZE * FRAMEBUFFER_TILE_SIZE + (_y % FRAMEBUFFER_TILE_SIZE) * FRAMEBUFFER_TILE_SIZE + _x % FRAMEBUFFER_TILE_SIZE;
+    }
+
+    // Read and write the color of the pixel at the given index, in the given format.
+    template<ColorFormat FORMAT> Color readColor (const int& _index) const;
+    template<ColorFormat FORMAT> float readAlpha (const int& _index) const;
+    template<ColorFormat FORMAT> void  writeColor(const int& _index, const Color& _color);
+
+    // Depth test: returns true if the given view-space depth is closer than (or as close as) the pixel's depth at the given index.
+    bool depthLess (const int& _index, const float& _depth) const;
+    bool depthEqual(const int& _index, const float& _depth) const;
+
+    // Writes the given view-space depth to the pixel at the given index.
+    void writeDepth(const int& _index, const float& _depth);
 
+    // Returns the color of the pixel at the given coordinates, whatever the color format.
+    Color getPixelColor(const int& _x, const int& _y) const;
+
+    // Returns the row-major color buffer to be displayed (packed colors, or Colors for RGBA32F),
+    // de-tiling it and resolving the tiles that were never drawn to if needed.
+    const void* getDisplayColors();
+
+#ifndef HEADLESS
     // Update the opengl texture with the color buffer.
     void updateTexture();
+#endif
+
+    // Fills _rgb with the rgb bytes of the color buffer, row by row (alpha is dropped, HDR colors are clamped).
+    void getDisplayRGB(std::vector<uint8_t>& _rgb);
+
+    // Writes the color buffer to a binary PPM image. Returns false on failure.
+    bool writePPM(FILE* _file);
 
     // Getters.
-    int    getWidth()        const { return width; }
-    int    getHeight()       const { return height; }
-    GLuint getColorTexture() const { return colorTexture; }
-};
\ No newline at end of file
+    int               getWidth()        const { return width; }
+    int               getHeight()       const { return height; }
+    int               getBufferSize()   const { return bufferSize; }
+    ColorFormat       getColorFormat()  const { return colorFormat; }
+    DepthFormat       getDepthFormat()  const { return depthFormat; }
+    FramebufferLayout getLayout()       const { return layout; }
+#ifndef HEADLESS
+    GLuint            getColorTexture() const { return colorTexture; }
+#endif
+};
+
+// Clamps a value to [0, 1] (NaN gives 0).
+static inline float clampUnit(const float& _value)
+{
+    // Written so that it compiles to branchless min/max instructions.
+    const float value = _value > 0 ? _value : 0;
+    return value < 1 ? value : 1;
+}
+
+// Converts a float to an n-bit unsigned normalized value, with rounding.
+static inline uint32_t floatToUnorm(const float& _value, const uint32_t& _max)
+{
+    return (uint32_t)(clampUnit(_value) * _max + 0.5f);
+}
+
+template<ColorFormat FORMAT>
+uint32_t Framebuffer::packColor(const Color& _color)
+{
+#ifdef FRAMEBUFFER_SSE
+    // Clamp the 4 channels at once (max first, so that NaN gives 0).
+    const __m128 color = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&_color.r), _mm_setzero_ps()), _mm_set1_ps(1));
+    if constexpr (FORMAT == ColorFormat::RGBA8)
+    {
+        // Round to 8 bits and narrow the 4 channels to bytes.
+        __m128i unorm = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(color, _mm_set1_ps(255)), _mm_set1_ps(0.5f)));
+        unorm = _mm_packs_epi32 (unorm, unorm);
+        unorm = _mm_packus_epi16(unorm, unorm);
+        return (uint32_t)_mm_cvtsi128_si32(unorm);
+    }
+#endif
+
+    uint32_t r, g, b;
+    if constexpr (FORMAT == ColorFormat::SRGB8_A8)
+    {
+        // Encode rgb with the sRGB table.
+        r = linearToSRGB[floatToUnorm(_color.r, SRGB_ENCODE_SIZE - 1)];
+        g = linearToSRGB[floatToUnorm(_color.g, SRGB_ENCODE_SIZE - 1)];
+        b = linearToSRGB[floatToUnorm(_color.b, SRGB_ENCODE_SIZE - 1)];
+    }
+    else
+    {
+        r = floatToUnorm(_color.r, 255);
+        g = floatToUnorm(_color.g, 255);
+        b = floatToUnorm(_color.b, 255);
+    }
+    return r | (g << 8) | (b << 16) | (floatToUnorm(_color.a, 255) << 24);
+}
+
+template<ColorFormat FORMAT>
+Color Framebuffer::unpackColor(const uint32_t& _packed)
+{
+#ifdef FRAMEBUFFER_SSE
+    if constexpr (FORMAT == ColorFormat::RGBA8)
+    {
+        // Widen the 4 bytes to floats.
+        const __m128i zero  = _mm_setzero_si128();
+        const __m128i unorm = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)_packed), zero), zero);
+        Color color;
+        _mm_storeu_ps(&color.r, _mm_mul_ps(_mm_cvtepi32_ps(unorm), _mm_set1_ps(1.f / 255.f)));
+        return color;
+    }
+#endif
+
+    const float alpha = (float)(_packed >> 24) * (1.f / 255.f);
+    if constexpr (FORMAT == ColorFormat::SRGB8_A8)
+        return { srgbToLinear[_packed & 0xFF], srgbToLinear[(_packed >> 8) & 0xFF], srgbToLinear[(_packed >> 16) & 0xFF], alpha };
+    else
+        return { (float)(_packed & 0xFF) * (1.f / 255.f), (float)((_packed >> 8) & 0xFF) * (1.f / 255.f), (float)((_packed >> 16) & 0xFF) * (1.f / 255.f), alpha };
+}
+
+template<ColorFormat FORMAT>
+Color Framebuffer::readColor(const int& _index) const
+{
+    if constexpr (FORMAT == ColorFormat::RGBA32F) return colorBuffer[_index];
+    else                                          return unpackColor<FORMAT>(packedColorBuffer[_index]);
+}
+
+template<ColorFormat FORMAT>
+float Framebuffer::readAlpha(const int& _index) const
+{
+    if constexpr (FORMAT == ColorFormat::RGBA32F) return colorBuffer[_index].a;
+    else                                          return (float)(packedColorBuffer[_index] >> 24) * (1.f / 255.f);
+}
+
+template<ColorFormat FORMAT>
+void Framebuffer::writeColor(const int& _index, const Color& _color)
+{
+    if constexpr (FORMAT == ColorFormat::RGBA32F) colorBuffer[_index]       = _color;
+    else                                          packedColorBuffer[_index] = packColor<FORMAT>(_color);
+}
+
+inline uint32_t Framebuffer::depthToUnorm(const float& _depth, const uint32_t& _max) const
+{
+    // Rounded in double precision: floats can't hold the halves of 24-bit values.
+    return (uint32_t)(clampUnit((_depth - depthNear) * invDepthRange) * (double)_max + 0.5);
+}
+
+// The depth format is picked at runtime: the branches always go the same way during a frame.
+inline bool Framebuffer::depthLess(const int& _index, const float& _depth) const
+{
+    switch (depthFormat)
+    {
+    case DepthFormat::FLOAT32:          return _depth < depthBuffer[_index];
+    case DepthFormat::FLOAT32_REVERSED: return depthNear / _depth > depthBuffer[_index];
+    case DepthFormat::UNORM16:          return depthToUnorm(_depth, 0xFFFF)   < depthBuffer16[_index];
+    default:                            return depthToUnorm(_depth, 0xFFFFFF) < depthBuffer24[_index];
+    }
+}
+
+inline bool Framebuffer::depthEqual(const int& _index, const float& _depth) const
+{
+    switch (depthFormat)
+    {
+    case DepthFormat::FLOAT32:          return _depth == depthBuffer[_index];
+    case DepthFormat::FLOAT32_REVERSED: return depthNear / _depth == depthBuffer[_index];
+    case DepthFormat::UNORM16:          return depthToUnorm(_depth, 0xFFFF)   == depthBuffer16[_index];
+    default:                            return depthToUnorm(_depth, 0xFFFFFF) == depthBuffer24[_index];
+    }
+}
+
+inline void Framebuffer::writeDepth(const int& _index, const float& _depth)
+{
+    switch (depthFormat)
+    {
+    case DepthFormat::FLOAT32:          depthBuffer  [_index] = _depth;                             break;
+    case DepthFormat::FLOAT32_REVERSED: depthBuffer  [_index] = depthNear / _depth;                 break;
+    case DepthFormat::UNORM16:          depthBuffer16[_index] = depthToUnorm(_depth, 0xFFFF);       break;
+    default:                            depthBuffer24[_index] = depthToUnorm(_depth, 0xFFFFFF);     break;
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Renderer.hpp>
+#include <Scene.hpp>
+
+// Initialization structure of the headless app.
+struct HeadlessInit
+{
+    int width, height;
+
+    // Number of frames to render, and the fixed time step between them (so that runs are reproducible).
+    int   frameCount;
+    float deltaTime;
+
+    // Path of the PPM files the frames are written to: "%d" is replaced by the frame index,
+    // "-" writes all the frames to stdout and nullptr doesn't write them.
+    const char* outputPath;
+
+    // Scene and render state.
+    ScenePreset    scene;
+    RenderMode     renderMode;
+    LightingMode   lightingMode;
+    RenderPipeline renderPipeline;
+    RasterBackend  rasterBackend;
+
+    // Path of the Chrome trace of the frames [traceFirst, traceFirst + traceCount) (a negative count traces all of them),
+    // nullptr doesn't write it.
+    const char* tracePath;
+    int         traceFirst, traceCount;
+
+    // Path of the CSV file the pipeline statistics of each frame are written to, nullptr doesn't write it.
+    const char* statsPath;
+};
+
+// Names of the scene presets and render states, as given to the headless tools' options.
+extern const char* const scenePresetNames   [SCENE_PRESET_COUNT];
+extern const char* const renderModeNames    [4];
+extern const char* const lightingModeNames  [2];
+extern const char* const renderPipelineNames[3];
+extern const char* const rasterBackendNames [2];
+
+// Parses one of the options shared by the headless tools (-w, -h, -n, -o, -s, -m, -l, -p, -b) into _init.
+// Returns false if the option is unknown or its value is invalid.
+bool parseHeadlessOption(const char& _option, const char* _value, HeadlessInit& _init);
+
+// Renders a scene into the CPU framebuffer, without a window, OpenGL or ImGui.
+class HeadlessApp
+{
+private:
+    HeadlessInit init;
+
+    // Writes the framebuffer's color buffer to the output of the given frame.
+    bool writeFrame(Framebuffer& _framebuffer, const int& _frame) const;
+
+public:
+    HeadlessApp(const HeadlessInit& _init);
+
+    // Renders all of the frames. Returns false if one of them couldn't be written.
+    bool update();
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+// Statistics of the pipeline stages during a frame, gathered by the renderer between two resetCounters calls
+// (each worker thread of the tiled backend fills its own, merged when the bins are rasterized).
+struct PipelineStats
+{
+    // Size of the viewport (in pixels), to compute the overdraw.
+    int pixels = 0;
+
+    // Vertex processing.
+    int verticesTransformed  = 0;
+    int lightingComputations = 0;  // Lighting computed on a vertex or pixel.
+
+    // Triangles, from the draws to the rasterizer:
+    //  - backfaceCulled:  facing away from the camera.
+    //  - clipped:         crossing the near/far planes or the guard band (split into the triangles of their clipped polygon).
+    //  - clipCulled:      clipped away entirely.
+    //  - frustumCulled:   outside of the viewport (but inside the guard band).
+    //  - zeroAreaCulled:  degenerate, or missing all pixel centers.
+    int trianglesSubmitted  = 0;
+    int backfaceCulled      = 0;
+    int clippedTriangles    = 0;
+    int clipCulled          = 0;
+    int frustumCulled       = 0;
+    int zeroAreaCulled      = 0;
+    int trianglesRasterized = 0;
+    int smallTriangles      = 0;
+
+    // Blocks tested against the edge functions.
+    int skippedBlocks = 0;
+    int partialBlocks = 0;
+    int coveredBlocks = 0;
+
+    // Fragments (covered pixels):
+    //  - tested:  went through the depth test (the visibility buffer's shading pass doesn't test them again).
+    //  - passed:  passed the depth test.
+    //  - killed:  discarded before the fragment stage by the early depth test.
+    //  - shaded:  ran the fragment stage.
+    //  - blended: were blended with the framebuffer's color.
+    int fragmentsTested  = 0;
+    int fragmentsPassed  = 0;
+    int earlyDepthKills  = 0;
+    int fragmentsShaded  = 0;
+    int fragmentsBlended = 0;
+    int textureSamples   = 0;
+
+    // Adds the counters of another thread (the pixel count is kept).
+    PipelineStats& operator+=(const PipelineStats& _stats);
+
+    // Returns the average number of fragments shaded per pixel.
+    float getOverdraw() const;
+};
+
+// Writes the pipeline statistics of each frame to a CSV file: a header, then one row per frame.
+class PipelineStatsCSV
+{
+private:
+    FILE* file  = nullptr;
+    int   frame = 0;
+
+public:
+    ~PipelineStatsCSV();
+
+    // Creates the file and writes its header. Returns false if it couldn't be opened.
+    bool open (const std::string& _path);
+    void close();
+    bool isOpen() const;
+
+    // Writes the statistics of the next frame.
+    bool writeFrame(const PipelineStats& _stats);
+};
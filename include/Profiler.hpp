@@ -0,0 +1,154 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Scoped zones are only compiled in when PROFILER is non-zero (the Makefile defines it, build with PROFILER=0 to remove them).
+#ifndef PROFILER
+#define PROFILER 0
+#endif
+
+// Stages of a frame measured by the profiler.
+enum class ProfileZone : int { CAMERA, CLEAR, SCENE, SHAPE, TRANSFORM, VERTEX_SHADING, TRIANGLE, TILE, RESOLVE, FLUSH, PRESENT, IMGUI };
+#define PROFILE_ZONE_COUNT 12
+
+// Number of frames kept for the histograms.
+#define PROFILER_HISTORY 128
+
+// Number of events kept by each thread's ring buffer (a power of 2).
+#define PROFILER_RING_SIZE 32768
+
+// Zone recorded by a thread, in ticks, with the values of its arguments (see profiler::zoneArgNames).
+struct ProfileEvent
+{
+    uint64_t    start, end;
+    ProfileZone zone;
+    int         args[2];
+};
+
+// Zones recorded by one thread. Only its own thread writes to it, and it is read between frames.
+struct ThreadProfile
+{
+    int         index;
+    std::string name;
+
+    // Time and number of each zone since the last frame.
+    uint64_t totals[PROFILE_ZONE_COUNT] = {};
+    int      counts[PROFILE_ZONE_COUNT] = {};
+
+    // Last events, the oldest ones are overwritten. Those before readCount were already read.
+    std::vector<ProfileEvent> ring;
+    uint64_t                  eventCount = 0;
+    uint64_t                  readCount  = 0;
+
+    ThreadProfile(const int& _index) : index(_index), name("Thread " + std::to_string(_index)), ring(PROFILER_RING_SIZE) {}
+
+    void addTotal(const ProfileZone& _zone, const uint64_t& _ticks)
+    {
+        totals[(int)_zone] += _ticks;
+        counts[(int)_zone]++;
+    }
+
+    void addEvent(const ProfileEvent& _event)
+    {
+        ring[eventCount++ & (PROFILER_RING_SIZE - 1)] = _event;
+    }
+};
+
+namespace profiler
+{
+    // Returns a timestamp in ticks (the time stamp counter on x86, steady_clock nanoseconds elsewhere).
+    inline uint64_t now()
+    {
+    #if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+    #else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+    #endif
+    }
+
+    // Returns the profile of the calling thread, registering it on its first call.
+    ThreadProfile* registerThread();
+    inline ThreadProfile& getThreadProfile()
+    {
+        thread_local ThreadProfile* profile = registerThread();
+        return *profile;
+    }
+
+    // Names the calling thread in the traces.
+    void setThreadName(const std::string& _name);
+
+    // Converts ticks to milliseconds (the tick rate is calibrated against steady_clock).
+    double ticksToMs(const uint64_t& _ticks);
+
+    // Ends the current frame: moves the zone totals of every thread to the histograms, and the events to the trace capture.
+    void newFrame();
+
+    // Returns the index of the current frame (the number of newFrame calls - 1).
+    int getFrameNumber();
+
+    // Records the events of the frames [_firstFrame, _firstFrame + _frameCount) (a negative count records until stopTrace),
+    // and writes them to _path as a Chrome trace (chrome://tracing, ui.perfetto.dev) once they are over.
+    void startTrace(const std::string& _path, const int& _firstFrame, const int& _frameCount);
+    bool isTracing();
+
+    // Writes the trace now, if there is one. Returns false if it couldn't be written.
+    bool stopTrace();
+
+    // Returns the duration (ms) and number of the zone during the last frame.
+    float getZoneTime (const ProfileZone& _zone);
+    int   getZoneCount(const ProfileZone& _zone);
+    float getFrameTime();
+
+    // Names of the zones and of their arguments (nullptr if unused).
+    extern const char* const zoneNames   [PROFILE_ZONE_COUNT];
+    extern const char* const zoneArgNames[PROFILE_ZONE_COUNT][2];
+
+#ifndef HEADLESS
+    // Shows the per-frame histogram of each zone.
+    void showImGuiControls();
+#endif
+}
+
+// Records the time between its construction and destruction in the calling thread's profile.
+// Fine scopes (run on each triangle or vertex) are only added to the totals, the others are also traced.
+class ProfileScope
+{
+private:
+    ThreadProfile& profile;
+    ProfileZone    zone;
+    bool           fine;
+    uint64_t       start;
+
+public:
+    int args[2] = { 0, 0 };
+
+    ProfileScope(const ProfileZone& _zone, const bool& _fine = false) : profile(profiler::getThreadProfile()), zone(_zone), fine(_fine), start(profiler::now()) {}
+    ~ProfileScope()
+    {
+        uint64_t end = profiler::now();
+        profile.addTotal(zone, end - start);
+        if (!fine) profile.addEvent({ start, end, zone, { args[0], args[1] } });
+    }
+};
+
+#if PROFILER
+#define PROFILE_CONCAT_(_a, _b)                 _a##_b
+#define PROFILE_CONCAT(_a, _b)                  PROFILE_CONCAT_(_a, _b)
+#define PROFILE_SCOPE(_zone)                    ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(_zone)
+#define PROFILE_FINE_SCOPE(_zone)               ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(_zone, true)
+#define PROFILE_NAMED_SCOPE(_name, _zone)       ProfileScope _name(_zone)
+#define PROFILE_SET_ARG(_name, _index, _value)  _name.args[_index] = (_value)
+#else
+#define PROFILE_SCOPE(_zone)
+#define PROFILE_FINE_SCOPE(_zone)
+#define PROFILE_NAMED_SCOPE(_name, _zone)
+#define PROFILE_SET_ARG(_name, _index, _value)
+#endif
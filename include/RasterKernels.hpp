@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+struct TriangleSetup;
+
+// Number of pixels evaluated at once by the span kernels.
+#define SPAN_WIDTH 8
+
+enum class RasterKernel : int { SCALAR, SSE, AVX2 };
+
+// Interpolated values of each pixel of a span.
+struct alignas(32) SpanValues
+{
+    float w0n[SPAN_WIDTH], w1n[SPAN_WIDTH], w2n[SPAN_WIDTH];
+    float depth[SPAN_WIDTH];
+    float u[SPAN_WIDTH], v[SPAN_WIDTH];
+};
+
+// Evaluates the edge functions of _count (<= SPAN_WIDTH) pixels of a row, starting with the values _w0, _w1, _w2.
+// Fills _values with the normalized barycentrics, depth and perspective-correct uvs of each pixel,
+// and returns a mask of the pixels that are inside the triangle.
+typedef int (*SpanKernel)(const TriangleSetup& _setup, int _w0, int _w1, int _w2, int _count, SpanValues& _values);
+
+// Same as a span kernel for pixels that are known to be inside the triangle (blocks covered by it):
+// only fills _values, without testing the pixels against the edges.
+typedef void (*SpanInterpolator)(const TriangleSetup& _setup, int _w0, int _w1, int _w2, int _count, SpanValues& _values);
+
+// Scalar kernels for triangles whose edge functions don't fit in 32 bits.
+int  spanScalarWide       (const TriangleSetup& _setup, int64_t _w0, int64_t _w1, int64_t _w2, int _count, SpanValues& _values);
+void interpolateScalarWide(const TriangleSetup& _setup, int64_t _w0, int64_t _w1, int64_t _w2, int _count, SpanValues& _values);
+
+// Returns true if the CPU can run the given kernel.
+bool isRasterKernelSupported(const RasterKernel& _kernel);
+
+// Returns the fastest kernel supported by the CPU.
+RasterKernel getBestRasterKernel();
+
+// Returns the span function of the given kernel, and its interpolation-only version.
+SpanKernel       getSpanKernel      (const RasterKernel& _kernel);
+SpanInterpolator getSpanInterpolator(const RasterKernel& _kernel);
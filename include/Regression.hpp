@@ -0,0 +1,87 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <HeadlessApp.hpp>
+
+// Reference scene of the regression test: a scene preset drawn with a render and lighting mode, and with the
+// optimized paths it exercises (raster kernel, framebuffer formats and layout).
+// Its golden image is rendered with the forward pipeline and the immediate backend, and every other
+// pipeline and backend must match it. The pipelines that draw translucent shapes in another order
+// have their own golden image (named after the pipeline), only stored when it differs from the
+// previous pipeline's.
+struct RegressionCase
+{
+    const char*  name;
+    ScenePreset  scene;
+    RenderMode   renderMode;
+    LightingMode lightingMode;
+
+    RasterKernel      kernel      = getBestRasterKernel();
+    ColorFormat       colorFormat = ColorFormat::RGBA8;
+    DepthFormat       depthFormat = DepthFormat::FLOAT32;
+    FramebufferLayout layout      = FramebufferLayout::LINEAR;
+};
+
+// Initialization structure of the regression test.
+struct RegressionInit
+{
+    int width, height;
+
+    // Directory of the golden images, directory the failing renders and their diff heatmaps are written to,
+    // and file of the performance baseline (nullptr for this machine's, in regression/baseline).
+    const char* goldenDir;
+    const char* outputDir;
+    const char* baselinePath;
+
+    // Largest difference allowed on a channel of a pixel (0-255).
+    int tolerance;
+
+    // Frame time measurement: the best of sampleCount batches of frames, each lasting at least batchMs
+    // (so that renders of a fraction of a millisecond are timed over several). A render whose frame time
+    // is perfThreshold over the baseline (0.25 for 25%) is reported as a regression.
+    int   sampleCount;
+    float batchMs;
+    float perfThreshold;
+
+    // Replace the golden images and the baseline with the current renders instead of comparing them.
+    bool update;
+};
+
+// Renders the reference scenes headlessly and compares them with their golden images and performance baseline.
+class Regression
+{
+private:
+    RegressionInit init;
+    std::string    baselinePath;
+
+    // Frame time (ms) of each render of the baseline, by name.
+    std::map<std::string, double> baseline;
+
+    // Renders a case with a pipeline and backend, and fills _rgb with the compared frame.
+    // Returns its frame time (ms) if _timed, 0 otherwise.
+    double render(const RegressionCase& _case, const RenderPipeline& _pipeline, const RasterBackend& _backend, std::vector<uint8_t>& _rgb, const bool& _timed) const;
+
+    // Fills _differences with the largest channel difference of each pixel, and returns the number of pixels over the tolerance.
+    int  findDifferences(const std::vector<uint8_t>& _rgb, const std::vector<uint8_t>& _golden, std::vector<int>& _differences) const;
+
+    // Compares a render with its golden image and writes a heatmap of their differences if they don't match.
+    // Returns false if a pixel is farther than the tolerance.
+    bool compare(const std::string& _name, const std::vector<uint8_t>& _rgb, const std::vector<uint8_t>& _golden) const;
+
+    // Replaces _golden (the previous pipeline's) with the pipeline's own golden image if it has one,
+    // rendering and storing it when updating. Returns false if it couldn't be written.
+    bool getGolden(const RegressionCase& _case, const RenderPipeline& _pipeline, std::vector<uint8_t>& _golden) const;
+
+    bool readBaseline ();
+    bool writeBaseline(const std::map<std::string, double>& _times) const;
+
+public:
+    Regression(const RegressionInit& _init);
+
+    // Runs every case. Returns false if an image doesn't match or a render got slower than the threshold.
+    bool run();
+};
@@ -1,11 +1,18 @@
 #pragma once
 
+#include <array>
 #include <vector>
+#include <utility>
 
 #include <Framebuffer.hpp>
 #include <Camera.hpp>
 #include <Light.hpp>
 #include <Texture.hpp>
+#include <Shaders.hpp>
+#include <ThreadPool.hpp>
+#include <RasterKernels.hpp>
+#include <Profiler.hpp>
+#include <PipelineStats.hpp>
 
 struct Viewport
 {
@@ -21,6 +28,122 @@ enum class RenderMode   : int { UNLIT, LIT, WIREFRAME, ZBUFFER };
 
 enum class LightingMode : int { PHONG, BLINN };   
 
+enum class RasterBackend : int { IMMEDIATE, TILED };
+
+enum class RenderPipeline : int { FORWARD, DEPTH_PREPASS, VISIBILITY_BUFFER };
+
+// Pass that triangles are drawn in (the opaque passes of the depth pre-pass and visibility buffer pipelines).
+enum class RenderPass : int { FORWARD, DEPTH_ONLY, DEPTH_EQUAL, VISIBILITY };
+
+// Depth test applied by the shading pixel pipelines.
+enum class DepthTest : int { LESS, EQUAL, ALWAYS };
+
+// Render state shared by the triangles of a draw.
+struct DrawInstance
+{
+    Material    material;
+    TextureData texture;
+    bool        vertexHueOnTextures;
+    Vector3     cameraPos;
+};
+
+// Visibility buffer pixel: the closest triangle and its draw instance. Triangle ids keep growing between frames,
+// so that the pixels left by the previous frames (ids below the first one of the frame) read as empty.
+#define EMPTY_VISIBILITY 0xFFFFFFFF
+struct VisibilitySample
+{
+    uint32_t triangle;
+    uint32_t instance;
+};
+
+// Size (in pixels) of the screen tiles used by the tiled backend.
+#define TILE_SIZE 64
+
+// Size (in pixels) of the blocks tested against the edge functions before rasterizing their pixels.
+// A block row is a single span.
+#define BLOCK_SIZE SPAN_WIDTH
+
+// Triangles whose bounding box is at most this size (in pixels) take the small triangle path.
+#define SMALL_TRIANGLE_SIZE 2
+
+// Largest guard band that keeps the fixed-point screen coordinates and edge steps in range.
+#define MAX_GUARD_BAND 64.f
+
+// Screen coordinates are snapped to 28.4 fixed-point before being rasterized.
+#define SUBPIXEL_BITS  4
+#define SUBPIXEL_SCALE (1 << SUBPIXEL_BITS)
+
+class Renderer;
+struct TriangleSetup;
+struct DrawInstance;
+
+// Draws the covered pixels (_mask) of a span starting at the framebuffer index _index.
+// There is one pixel pipeline per render state, picked once per triangle.
+typedef void (Renderer::*PixelPipeline)(const TriangleSetup& _setup, const DrawInstance& _instance, const int& _index,
+                                        int _mask, const SpanValues& _span, PipelineStats& _stats);
+
+// Pixel pipelines of a shader: color formats x textured x hue x blending x 3 depth tests.
+#define PIXEL_PIPELINE_COUNT (COLOR_FORMAT_COUNT * 2 * 2 * 2 * 3)
+
+// Entry points of a shader, instantiated once per shader type.
+struct ShaderProgram
+{
+    Color (*vertexStage)(const ShaderContext& _context, const ShaderVertex& _vertex);
+    ShaderLighting lighting;
+    std::array<PixelPipeline, PIXEL_PIPELINE_COUNT> pixelPipelines;
+};
+
+// Everything needed to rasterize a triangle once its vertices have been transformed.
+struct TriangleSetup
+{
+    Vector3 perspectiveUV [3];
+    Vector4 worldCoords   [3];
+    Color   vertexColors  [3];
+    Color   varyings      [3];  // Outputs of the shader's vertex stage.
+    Vector3 worldNormal;
+
+    uint32_t      instance;
+    uint32_t      id;  // Visibility buffer id: visibilityFirstId + index in the visibility triangles (visibility pass only).
+    PixelPipeline pixelPipeline;
+
+    // Screen-clamped bounding box.
+    int minX, minY, maxX, maxY;
+
+    // Edge function steps per pixel and values at the center of pixel (minX, minY), with the fill rule bias.
+    int     A01, B01, A12, B12, A20, B20;
+    int64_t w0Origin, w1Origin, w2Origin;
+    int     bias0, bias1, bias2;  // Fill rule biases, removed before normalizing the barycentric coordinates.
+    float   invArea;     // Inverse of the edge functions' sum, to normalize the barycentric coordinates.
+    bool    wideEdges;   // The edge functions overflow 32 bits inside the bounding box.
+
+    // Small triangles: coverage of their pixel centers, one bit per pixel of the bounding box.
+    bool isSmall;
+    int  sampleMask;
+};
+
+// Constants shared by the vertices of a draw, rebuilt when the matrices change.
+struct DrawConstants
+{
+    Mat4    model;
+    Mat4    mvp;        // Model-view-projection matrix: local space -> clip space.
+    Mat4    normal;     // Inverse transpose of the model matrix, to bring normals to world space.
+    Vector3 cameraPos;  // Camera position in world space.
+
+    // NDC -> screen coordinates.
+    geometry2D::Vector2 viewportScale;
+    geometry2D::Vector2 viewportOffset;
+};
+
+// Vertex of an indexed draw once it went through the vertex stage, shared by the triangles that use it.
+struct TransformedVertex
+{
+    Vector3 worldNormal;
+    Color   varying     = { 1, 1, 1, 1 };
+    bool    inside      = false;  // Inside the clip volume and guard band.
+    bool    transformed = false;  // Its normal was transformed.
+    bool    shaded      = false;  // The shader's vertex stage ran on it.
+};
+
 class Renderer
 {
 private:
@@ -31,13 +154,15 @@ private:
     bool vertexHueOnTextures = false;
     bool cullBackFaces       = true;
 
-    // Counters and clocks.
-    int     triangleCounter   = 0;
-    clock_t triangleDuration  = 0;
-    int     lightingCounter   = 0;
-    clock_t lightingDuration  = 0;
-    int     transformCounter  = 0;
-    clock_t transformDuration = 0;
+    // Size of the guard band, as a multiple of the viewport's size. Triangles that stay inside it
+    // are only scissored by the bounding box clamp, the others are clipped on x/y.
+    float guardBand = 2;
+
+    // Pipeline statistics of the current frame (their durations are measured by the profiler's zones),
+    // and the CSV file they are written to at the end of each frame.
+    PipelineStats    stats;
+    PipelineStatsCSV statsCSV;
+    bool             statsPending = false;  // The stats hold a frame that wasn't written yet.
 
     // The three transformation matrices.
     std::vector<Mat4> modelMat;
@@ -47,8 +172,76 @@ private:
     // Scene components copied datas.
     std::vector<Light>* lights;
 
-    RenderMode   renderMode;
-    LightingMode lightingMode;
+    RenderMode    renderMode;
+    LightingMode  lightingMode;
+    RasterBackend rasterBackend;
+    RasterKernel  rasterKernel;
+    SpanKernel       spanKernel;
+    SpanInterpolator spanInterpolator;  // Covered blocks.
+
+    RenderPipeline renderPipeline;
+    RenderPass     renderPass;
+
+    // Draw instances of this frame (a new one is added when the render state changes).
+    std::vector<DrawInstance> instances;
+    bool                      instanceDirty = true;
+
+    // Constants of the current draw.
+    DrawConstants constants;
+    bool          constantsDirty = true;
+
+    // Post-transform cache of the current indexed draw, one entry per vertex of its vertex buffer.
+    std::vector<TransformedVertex> vertexCache;
+
+    // Vertex positions of the current indexed draw, transformed all at once.
+    std::vector<Vector3> localPositions;
+    std::vector<Vector4> worldPositions, clipPositions;
+
+    // Visibility buffer pipeline: triangles of the visibility pass and the closest one at each pixel.
+    // The buffer isn't cleared between frames: only the samples from visibilityFirstId are of the current one.
+    std::vector<TriangleSetup>    visibilityTriangles;
+    std::vector<VisibilitySample> visibilityBuffer;
+    uint32_t                      visibilityFirstId = 0;
+    uint32_t                      visibilityNextId  = 0;
+
+    // Tiled backend: triangles set up this frame and the triangle indices binned in each tile.
+    ThreadPool                         threadPool;
+    std::vector<TriangleSetup>         binnedTriangles;
+    std::vector<std::vector<uint32_t>> tileBins;
+    int                                tilesX, tilesY;
+
+    float    getClipExtent    () const;
+    bool     setupEdges       (const Vector3* _screenCoords, TriangleSetup& _setup);
+    uint32_t getInstance      (const Vector3& _cameraPos);
+    const DrawConstants& getDrawConstants();
+    void     drawTransformedTriangle(Vertex* _vertices, Vector4* _worldCoords, Vector4* _clipCoords, const bool& _inside,
+                                     const Vector3& _worldNormal, const Vector3& _cameraPos, const Color* _varyings = nullptr);
+    void     binTriangle      (const TriangleSetup& _setup);
+    int      evaluateSpan     (const TriangleSetup& _setup, const int64_t& _w0, const int64_t& _w1, const int64_t& _w2, const int& _count, SpanValues& _span) const;
+    void     interpolateSpan  (const TriangleSetup& _setup, const int64_t& _w0, const int64_t& _w1, const int64_t& _w2, const int& _count, SpanValues& _span) const;
+    void     rasterizeTriangle(const TriangleSetup& _setup, int _minX, int _minY, int _maxX, int _maxY, PipelineStats& _stats);
+    void     rasterizeSmallTriangle(const TriangleSetup& _setup, const DrawInstance& _instance, int _minX, int _minY, int _maxX, int _maxY, PipelineStats& _stats);
+    void     rasterizeBins    ();
+    void     mergeStats       (const std::vector<PipelineStats>& _workerStats);
+
+    // ---- Pixel pipelines ---- //
+
+    // Custom shader set by setShader (the render and lighting modes pick a built-in shader when null).
+    const ShaderProgram* shader = nullptr;
+
+    template<ColorFormat FORMAT, bool DEPTH, bool BLEND>
+    bool  blendPixel   (const int& _index, const bool& _isCloser, const float& _depth, Color _color);
+    template<typename SHADER, ColorFormat FORMAT, bool TEXTURED, bool HUE, bool BLEND, DepthTest TEST>
+    void  shadeSpan    (const TriangleSetup& _setup, const DrawInstance& _instance, const int& _index, int _mask, const SpanValues& _span, PipelineStats& _stats);
+    void  depthSpan    (const TriangleSetup& _setup, const DrawInstance& _instance, const int& _index, int _mask, const SpanValues& _span, PipelineStats& _stats);
+    void  visibilitySpan(const TriangleSetup& _setup, const DrawInstance& _instance, const int& _index, int _mask, const SpanValues& _span, PipelineStats& _stats);
+
+    template<typename SHADER, size_t... I>
+    static std::array<PixelPipeline, sizeof...(I)> makePixelPipelines(std::index_sequence<I...>);
+    template<typename SHADER>
+    static const ShaderProgram& getShaderProgram();
+    const ShaderProgram& getActiveShader () const;
+    PixelPipeline        getPixelPipeline(const ShaderProgram& _shader, const DrawInstance& _instance, const bool& _opaque, const DepthTest& _test) const;
 
 public:
     Framebuffer framebuffer;
@@ -77,15 +270,20 @@ public:
 
     void drawPixel        (const unsigned int& _x, const unsigned int& _y, const float& _depth, Color _color);
     void drawLine         (const geometry3D::Vertex& _p0, const geometry3D::Vertex& _p1);
-    bool transformVertices(int _count, Vertex* _vertices, Vector3* _local, Vector4* _world,
-                           Vector4* _view, Vector4* _clip, Vector3* _ndc, Vector3* _screen, Vector3* _perspectiveUV);
+    bool transformVertices(int _count, Vertex* _vertices, Vector3* _local, Vector4* _world, Vector4* _clip);
+    bool projectVertices  (Vertex* _vertices, Vector4* _world, const Vector4* _clip,
+                           Vector3* _ndc, Vector3* _screen, Vector3* _perspectiveUV);
     bool wireframeTriangle(Vector3* _screenCoords, Vertex* _vertices);
     void drawTriangle     (geometry3D::Triangle3 _triangle);
+    void drawClipSpaceTriangle(Vertex* _vertices, Vector4* _worldCoords, const Vector4* _clipCoords,
+                               const Vector3& _worldNormal, const Vector3& _cameraPos, const Color* _varyings = nullptr);
     void drawTriangles    (geometry3D::Triangle3* _triangles, const unsigned int& _count);
+    void drawIndexed      (const Vertex* _vertices, const unsigned int& _vertexCount, const uint32_t* _indices, const unsigned int& _indexCount);
     void drawDividedQuad  (const Color& _color, const float& _size = 1.f, const bool& _negateNormals = false);
     void drawCube         (const Color& _color, const float& _size = 1.f);
     void drawDividedCube  (const Color& _color, const float& _size = 1.f, const float& _res = 1.f);
     void drawSphere       (const Color& _color, const float& _r, const int& _lon, const int& _lat);
+    void flush            ();
 
     // --- Material and texture methods --- //
 
@@ -93,10 +291,45 @@ public:
     Material getMaterial() const;
     void     setMaterial(const Material& _material);
 
+    // ------------- Shaders ------------- //
+
+    // Draws the next triangles with SHADER instead of the built-in shader of the render mode.
+    template<typename SHADER>
+    void setShader  ();
+    void resetShader();
+
     // ---------- Miscellaneous ---------- //
     
     void applyVertexColorToTextures(const bool& _boolean);
     void doBackfaceCulling(const bool& _boolean);
-    void resetCounters();
+    void setRasterBackend (const RasterBackend& _backend);
+    void setRasterKernel  (const RasterKernel& _kernel);
+    void setRenderMode    (const RenderMode& _mode);
+    void setLightingMode  (const LightingMode& _mode);
+    void  setGuardBand    (const float& _guardBand);
+    float getGuardBand    () const;
+#ifndef HEADLESS
     void showImGuiControls();
-};
\ No newline at end of file
+#endif
+
+    // ------- Pipeline statistics ------- //
+
+    // Ends the statistics of the last frame (writing them to the CSV file if there is one) and starts a new frame.
+    void resetCounters();
+    const PipelineStats& getPipelineStats() const;
+
+    // Writes the pipeline statistics of each frame to a CSV file, until stopStatsCSV is called.
+    bool startStatsCSV (const std::string& _path);
+    void stopStatsCSV  ();
+    bool isWritingStats() const;
+
+    // ------- Multi-pass pipelines ------- //
+
+    void           setRenderPipeline (const RenderPipeline& _pipeline);
+    RenderPipeline getRenderPipeline () const;
+    RenderPipeline getActivePipeline () const;
+    void           setRenderPass     (const RenderPass& _pass);
+    void           resolveVisibility ();
+};
+
+#include <Renderer.inl>
\ No newline at end of file
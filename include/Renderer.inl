@@ -0,0 +1,95 @@
+#pragma once
+
+// Pixel pipeline templates, included by Renderer.hpp so that setShader can instantiate them for any shader.
+
+template<ColorFormat FORMAT, bool DEPTH, bool BLEND>
+bool Renderer::blendPixel(const int& _index, const bool& _isCloser, const float& _depth, Color _color)
+{
+    float bufferAlpha = framebuffer.readAlpha<FORMAT>(_index);
+
+    // Alpha blending (opaque triangles only blend over translucent pixels).
+    bool blended    = false;
+    bool blendAlpha = false;
+    if ((BLEND && _color.a <= 0.99) || bufferAlpha <= 0.99)
+    {
+        blended = true;
+        Color bufferColor = framebuffer.readColor<FORMAT>(_index);
+        blendAlpha = bufferAlpha <= 0.99;
+        float alpha = (_isCloser ? _color.a : ((_color.a + 1 - bufferColor.a) / 2));
+        _color = _color * alpha + bufferColor * (1 - alpha);
+    }
+
+    // Draw the pixel (color or depth) if it is closer than the previous one.
+    if (_isCloser || blendAlpha)
+    {
+        framebuffer.writeDepth(_index, _depth);
+        if constexpr (DEPTH) framebuffer.writeColor<FORMAT>(_index, { _depth, _depth, _depth, 1 });
+        else                 framebuffer.writeColor<FORMAT>(_index, _color);
+    }
+    return blended;
+}
+
+template<typename SHADER, ColorFormat FORMAT, bool TEXTURED, bool HUE, bool BLEND, DepthTest TEST>
+void Renderer::shadeSpan(const TriangleSetup& _setup, const DrawInstance& _instance, const int& _index, int _mask, const SpanValues& _span, PipelineStats& _stats)
+{
+    const ShaderContext context = { *lights, _instance.material, _instance.cameraPos };
+
+    // Render the pixels that are on or inside all edges.
+    for (; _mask != 0; _mask &= _mask - 1)
+    {
+        int   i     = __builtin_ctz(_mask);
+        int   index = _index + i;
+        float depth = _span.depth[i];
+
+        // Early depth test: don't shade fragments that would be discarded (farther than an opaque pixel,
+        // or not the closest one when the depth was laid down by a pre-pass).
+        bool isCloser = true;
+        if constexpr (TEST == DepthTest::LESS)
+        {
+            isCloser = framebuffer.depthLess(index, depth);
+            _stats.fragmentsTested++;
+            _stats.fragmentsPassed += isCloser;
+            if (!isCloser && framebuffer.readAlpha<FORMAT>(index) > 0.99) { _stats.earlyDepthKills++; continue; }
+        }
+        else if constexpr (TEST == DepthTest::EQUAL)
+        {
+            isCloser = framebuffer.depthEqual(index, depth);
+            _stats.fragmentsTested++;
+            _stats.fragmentsPassed += isCloser;
+            if (!isCloser) { _stats.earlyDepthKills++; continue; }
+        }
+
+        // Run the fragment stage.
+        const ShaderFragment<TEXTURED, HUE> fragment = { _span.w0n[i], _span.w1n[i], _span.w2n[i], depth, _span.u[i], _span.v[i],
+                                                         _setup.worldCoords, _setup.vertexColors, _setup.varyings, _setup.worldNormal, _instance.texture };
+        Color color = SHADER::fragment(context, fragment);
+        _stats.fragmentsShaded++;
+        if constexpr (TEXTURED)
+            _stats.textureSamples += SHADER::textureSamples;
+        if constexpr (SHADER::lighting == ShaderLighting::PER_PIXEL)
+            _stats.lightingComputations++;
+
+        // Draw the pixel.
+        _stats.fragmentsBlended += blendPixel<FORMAT, SHADER::outputDepth, BLEND>(index, isCloser, depth, color);
+    }
+}
+
+// Builds the pixel pipelines of a shader. The index I encodes the render state (see getPixelPipeline).
+template<typename SHADER, size_t... I>
+std::array<PixelPipeline, sizeof...(I)> Renderer::makePixelPipelines(std::index_sequence<I...>)
+{
+    return {{ &Renderer::shadeSpan<SHADER, (ColorFormat)(I / 24), (I / 12) % 2 == 1, (I / 6) % 2 == 1, (I / 3) % 2 == 1, (DepthTest)(I % 3)>... }};
+}
+
+template<typename SHADER>
+const ShaderProgram& Renderer::getShaderProgram()
+{
+    static const ShaderProgram program = { &SHADER::vertex, SHADER::lighting, makePixelPipelines<SHADER>(std::make_index_sequence<PIXEL_PIPELINE_COUNT>()) };
+    return program;
+}
+
+template<typename SHADER>
+void Renderer::setShader()
+{
+    shader = &getShaderProgram<SHADER>();
+}
@@ -9,6 +9,14 @@
 
 class Renderer;
 
+// Shapes that a scene starts with (the lights are always the same).
+//  - DEFAULT:            a translucent cube next to a sphere.
+//  - SPHERE_WALL:        a wall of spheres with 100 subdivisions (lots of small triangles).
+//  - TRANSLUCENT_STACKS: overlapping translucent quads and cubes (blending and overdraw).
+//  - TEXTURED_CUBES:     rotated cubes with a different texture each.
+enum class ScenePreset : int { DEFAULT, SPHERE_WALL, TRANSLUCENT_STACKS, TEXTURED_CUBES };
+#define SCENE_PRESET_COUNT 4
+
 class Scene
 {
 private:
@@ -17,12 +25,14 @@ private:
     ShapeManager shapeManager;
     
 public:
-    Scene();
+    Scene(const ScenePreset& _preset = ScenePreset::DEFAULT);
     ~Scene() {}
 
     void update(const float& _deltaTime, Renderer& _renderer, const Camera& _camera);
 
     std::vector<Light>* getLights();
 
+#ifndef HEADLESS
     void showImGuiControls(Renderer& _renderer);
+#endif
 };
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <vector>
+
+#include <Light.hpp>
+#include <Texture.hpp>
+
+// A shader is a struct with static members, passed to the renderer as a template parameter so that
+// its stages are inlined into the pixel pipelines:
+//  - lighting:       where the shader computes lighting (only used by the lighting counters).
+//  - outputDepth:    draw the pixels' depth instead of their color.
+//  - textureSamples: number of texture samples of the fragment stage on textured triangles (only used by the pipeline statistics).
+//  - vertex:         Color vertex(const ShaderContext&, const ShaderVertex&), run on the 3 vertices of each triangle.
+//                    Its output is interpolated for the fragment stage (see ShaderFragment::varying).
+//  - fragment:       template<typename F> Color fragment(const ShaderContext&, const F&), run on each visible pixel.
+
+enum class ShaderLighting : int { NONE, PER_VERTEX, PER_PIXEL };
+
+// Render state of the draw that is being shaded.
+struct ShaderContext
+{
+    const std::vector<Light>& lights;
+    const Material&           material;
+    const Vector3&            cameraPos;
+};
+
+// Input of the vertex stage.
+struct ShaderVertex
+{
+    Vector3 worldPos;
+    Vector3 worldNormal;
+    Color   color;
+};
+
+// Input of the fragment stage: the pixel's normalized barycentric coordinates, depth and perspective-correct uvs,
+// and the triangle's vertex attributes. TEXTURED and HUE pick how the surface color is sampled.
+template<bool TEXTURED, bool HUE>
+struct ShaderFragment
+{
+    float w0n, w1n, w2n;
+    float depth;
+    float u, v;
+
+    const Vector4*     worldCoords;
+    const Color*       vertexColors;
+    const Color*       varyings;
+    const Vector3&     worldNormal;
+    const TextureData& texture;
+
+    // Returns the pixel's world position.
+    Vector3 worldPos() const
+    {
+        return (worldCoords[0] * w0n + worldCoords[1] * w1n + worldCoords[2] * w2n).toVector3();
+    }
+
+    // Returns the interpolated vertex color.
+    Color vertexColor() const
+    {
+        return { vertexColors[0].r * w0n + vertexColors[1].r * w1n + vertexColors[2].r * w2n,
+                 vertexColors[0].g * w0n + vertexColors[1].g * w1n + vertexColors[2].g * w2n,
+                 vertexColors[0].b * w0n + vertexColors[1].b * w1n + vertexColors[2].b * w2n,
+                 vertexColors[0].a * w0n + vertexColors[1].a * w1n + vertexColors[2].a * w2n };
+    }
+
+    // Returns the interpolated rgb output of the vertex stage (its alpha is always 1).
+    Color varying() const
+    {
+        return { w0n * varyings[0].r + w1n * varyings[1].r + w2n * varyings[2].r,
+                 w0n * varyings[0].g + w1n * varyings[1].g + w2n * varyings[2].g,
+                 w0n * varyings[0].b + w1n * varyings[1].b + w2n * varyings[2].b };
+    }
+
+    // Returns the surface color: the vertex color, replaced or hued by the texture if there is one.
+    Color albedo() const
+    {
+        Color pCol = vertexColor();
+        if constexpr (TEXTURED)
+        {
+            // Get the pixel color from the texture.
+            Color texColor = texture.getPixelColor(arithmetic::floorInt(arithmetic::clamp(u, 0, 1) * std::abs(texture.width )),
+                                                   arithmetic::floorInt(arithmetic::clamp(v, 0, 1) * std::abs(texture.height)),
+                                                   pCol.a);
+
+            // Apply the pixel hue to the texture color.
+            if constexpr (HUE)
+            {
+                HSV pHSV = arithmetic::RGBtoHSV(texColor);
+                return arithmetic::HSVtoRGB({ pCol.getHue(), pHSV.s, pHSV.v }, pCol.a);
+            }
+            // Apply the texture color to the pixel color.
+            else
+            {
+                pCol.r = texColor.r;
+                pCol.g = texColor.g;
+                pCol.b = texColor.b;
+            }
+        }
+        return pCol;
+    }
+};
+
+// ---------- Built-in shaders ---------- //
+
+// Vertex colors and textures, without lighting.
+struct UnlitShader
+{
+    static constexpr ShaderLighting lighting       = ShaderLighting::NONE;
+    static constexpr bool           outputDepth    = false;
+    static constexpr int            textureSamples = 1;
+
+    static Color vertex(const ShaderContext&, const ShaderVertex&) { return WHITE; }
+
+    template<typename F>
+    static Color fragment(const ShaderContext&, const F& _fragment) { return _fragment.albedo(); }
+};
+
+// Phong lighting computed on each vertex and interpolated between them.
+struct PhongShader
+{
+    static constexpr ShaderLighting lighting       = ShaderLighting::PER_VERTEX;
+    static constexpr bool           outputDepth    = false;
+    static constexpr int            textureSamples = 1;
+
+    static Color vertex(const ShaderContext& _context, const ShaderVertex& _vertex)
+    {
+        return computePhong(_context.lights, _context.material, _vertex.worldPos, _vertex.worldNormal, _context.cameraPos);
+    }
+
+    template<typename F>
+    static Color fragment(const ShaderContext&, const F& _fragment)
+    {
+        Color pCol = _fragment.albedo();
+        pCol *= _fragment.varying();
+        return pCol;
+    }
+};
+
+// Blinn-Phong lighting computed on each pixel.
+struct BlinnShader
+{
+    static constexpr ShaderLighting lighting       = ShaderLighting::PER_PIXEL;
+    static constexpr bool           outputDepth    = false;
+    static constexpr int            textureSamples = 1;
+
+    static Color vertex(const ShaderContext&, const ShaderVertex&) { return WHITE; }
+
+    template<typename F>
+    static Color fragment(const ShaderContext& _context, const F& _fragment)
+    {
+        Color pLight = computePhong(_context.lights, _context.material, _fragment.worldPos(), _fragment.worldNormal, _context.cameraPos);
+        Color pCol   = _fragment.albedo();
+        pCol *= pLight;
+        return pCol;
+    }
+};
+
+// Grayscale depth, blended with the vertex alpha.
+struct DepthShader
+{
+    static constexpr ShaderLighting lighting       = ShaderLighting::NONE;
+    static constexpr bool           outputDepth    = true;
+    static constexpr int            textureSamples = 0;
+
+    static Color vertex(const ShaderContext&, const ShaderVertex&) { return WHITE; }
+
+    template<typename F>
+    static Color fragment(const ShaderContext&, const F& _fragment)
+    {
+        return { _fragment.depth, _fragment.depth, _fragment.depth, _fragment.vertexColor().a };
+    }
+};
@@ -2,7 +2,6 @@
 
 #include <vector>
 #include <string>
-#include <imgui_impl_glfw.h>
 
 #include <my_math.hpp>
 #include <Light.hpp>
@@ -41,6 +40,8 @@ private:
     std::vector<TextureData> textures;
     std::vector<Shape> shapes;
 
+    void drawShape(Renderer& _renderer, const Shape& _shape);
+
 public:
     ShapeManager();
     ~ShapeManager();
@@ -48,9 +49,12 @@ public:
     void   addShape   (Shape _shape = { ShapeTypes::CUBE, 1, { 0, 0, 2 }, { 0, 0, 0 }, { 1, 1, 0.2 } });
     Shape& getShape   (const int& _index);
     int    getShapeNum();
+    int    getTextureNum();
     void   delShape   (const int& _index);
 
     void drawShapes(Renderer& _renderer);
 
+#ifndef HEADLESS
     void showImGuiControls();
+#endif
 };
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <glad/gl.h>
 #include <cstdint>
 #include "my_math.hpp"
 
@@ -35,7 +34,7 @@ public:
     TextureData() : pixels(0), width(0), height(0), padding(0) {}
     ~TextureData() {  }
 
-    Color getPixelColor(const int& _x, const int& _y, const float& _alpha = 1);
+    Color getPixelColor(const int& _x, const int& _y, const float& _alpha = 1) const;
 };
 
 TextureData loadBmpData(const char* _filename);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+// Persistent worker threads that split indexed jobs between them.
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+
+    // Synchronisation between the calling thread and the workers.
+    std::mutex              jobMutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+
+    // Current job.
+    std::function<void(int, int)> job;
+    std::atomic<int>              nextIndex { 0 };
+    int  jobCount      = 0;
+    int  generation    = 0;
+    int  activeWorkers = 0;
+    bool stopping      = false;
+
+    void workerLoop(const int _workerIndex);
+    void runJobs   (const int _workerIndex);
+
+public:
+    // Spawns _threadCount-1 workers (the calling thread is the last one). 0 uses every hardware thread.
+    ThreadPool(int _threadCount = 0);
+    ~ThreadPool();
+
+    // Calls _job(index, workerIndex) for every index in [0, _count) and returns when they are all done.
+    void parallelFor(const int& _count, const std::function<void(int, int)>& _job);
+
+    // Number of threads that run jobs, including the calling thread.
+    int getThreadCount() const { return (int)workers.size() + 1; }
+};
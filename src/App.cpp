@@ -4,6 +4,7 @@
 #include "Framebuffer.hpp"
 #include "Camera.hpp"
 #include "Scene.hpp"
+#include "Profiler.hpp"
 
 using namespace matrix;
 
@@ -21,9 +22,12 @@ void App::newFrame(bool _mouseCaptured)
 //Clear buffer et render ImGUI
 void App::endFrame()
 {
-    glClear(GL_COLOR_BUFFER_BIT);
-    ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    {
+        PROFILE_SCOPE(ProfileZone::IMGUI);
+        glClear(GL_COLOR_BUFFER_BIT);
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
 
     glfwSwapBuffers(window);
 }
@@ -104,8 +108,13 @@ void App::update()
     double mouseX      = 0, mouseY      = 0;
     float  mouseDeltaX = 0, mouseDeltaY = 0;
 
+    profiler::setThreadName("Main");
+
     while (glfwWindowShouldClose(window) == false)
     {
+        // Move the profiled zones of the last frame to the histograms.
+        profiler::newFrame();
+
         newFrame(mouseCaptured);
 
         // Update the mouse pos and delta.
@@ -126,6 +135,7 @@ void App::update()
         // Update the camera position and rotation according to keybinds.
         if (mouseCaptured)
         {
+            PROFILE_SCOPE(ProfileZone::CAMERA);
             inputs.deltaX       = mouseDeltaX;
             inputs.deltaY       = mouseDeltaY;
             inputs.mouseWheel   = io.MouseWheel;
@@ -155,26 +165,44 @@ void App::update()
         renderer.resetCounters();
 
         // Clear buffers.
-        renderer.framebuffer.clear(camera.getFar());
+        {
+            PROFILE_SCOPE(ProfileZone::CLEAR);
+            renderer.framebuffer.clear(camera.getNear(), camera.getFar());
+        }
 
         // Setup matrices.
         renderer.setProjection(camera.getPerspective());
         renderer.setView(camera.getViewMat());
 
         // Render scene.
-        scene.update(io.DeltaTime, renderer, camera);
+        {
+            PROFILE_SCOPE(ProfileZone::SCENE);
+            scene.update(io.DeltaTime, renderer, camera);
+        }
+
+        // Rasterize the triangles binned by the tiled backend.
+        {
+            PROFILE_SCOPE(ProfileZone::FLUSH);
+            renderer.flush();
+        }
 
         // Update texture.
-        renderer.framebuffer.updateTexture();
+        {
+            PROFILE_SCOPE(ProfileZone::PRESENT);
+            renderer.framebuffer.updateTexture();
+        }
 
         // Display debug controls.
-        if (ImGui::Begin("Config"))
         {
-            if (ImGui::CollapsingHeader("Renderer", ImGuiTreeNodeFlags_DefaultOpen)) renderer.showImGuiControls();
-            if (ImGui::CollapsingHeader("Camera",   ImGuiTreeNodeFlags_DefaultOpen)) camera.showImGuiControls();
-            scene.showImGuiControls(renderer);
+            PROFILE_SCOPE(ProfileZone::IMGUI);
+            if (ImGui::Begin("Config"))
+            {
+                if (ImGui::CollapsingHeader("Renderer", ImGuiTreeNodeFlags_DefaultOpen)) renderer.showImGuiControls();
+                if (ImGui::CollapsingHeader("Camera",   ImGuiTreeNodeFlags_DefaultOpen)) camera.showImGuiControls();
+                scene.showImGuiControls(renderer);
+            }
+            ImGui::End();
         }
-        ImGui::End();
 
         // Display the rasterizer's output.
         bool isOpen = false;
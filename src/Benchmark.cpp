@@ -0,0 +1,172 @@
+#include <cmath>
+#include <cstdio>
+#include <chrono>
+#include <string>
+#include <algorithm>
+
+#include "Benchmark.hpp"
+#include "Renderer.hpp"
+#include "Camera.hpp"
+#include "Scene.hpp"
+
+using namespace std;
+
+static const char* const stageNames [BENCHMARK_STAGE_COUNT] = { "clear", "draw", "flush", "resolve", "frame" };
+static const char* const kernelNames[3]                     = { "scalar", "sse", "avx2" };
+
+// Returns the time elapsed since _start, in milliseconds.
+static double elapsedMs(const chrono::steady_clock::time_point& _start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - _start).count();
+}
+
+// Computes the statistics of a list of durations (p99 is the nearest-rank percentile).
+static StageStats computeStats(vector<double> _durations)
+{
+    if (_durations.empty()) return { 0, 0, 0, 0 };
+
+    sort(_durations.begin(), _durations.end());
+    const size_t count = _durations.size();
+
+    StageStats stats;
+    stats.min    = _durations.front();
+    stats.median = count % 2 == 1 ? _durations[count / 2] : (_durations[count / 2 - 1] + _durations[count / 2]) / 2;
+    stats.p99    = _durations[(size_t)ceil(0.99 * count) - 1];
+    stats.mean   = 0;
+    for (const double& duration : _durations) stats.mean += duration;
+    stats.mean /= count;
+    return stats;
+}
+
+Benchmark::Benchmark(const BenchmarkInit& _init)
+    : init(_init)
+{
+}
+
+SceneResults Benchmark::runScene(const ScenePreset& _scene) const
+{
+    // Initialize the scene and renderer like the headless app.
+    Scene scene(_scene);
+
+    Renderer renderer(init.render.width, init.render.height, scene.getLights());
+    renderer.setRenderMode    (init.render.renderMode);
+    renderer.setLightingMode  (init.render.lightingMode);
+    renderer.setRenderPipeline(init.render.renderPipeline);
+    renderer.setRasterBackend (init.render.rasterBackend);
+
+    Camera camera(renderer.framebuffer.getWidth(), renderer.framebuffer.getHeight(), 90.f, 0.001f, 1000.f, 2.5f);
+
+    vector<double> durations[BENCHMARK_STAGE_COUNT];
+    long long      triangles = 0;
+    for (int frame = 0; frame < init.warmupCount + init.render.frameCount; frame++)
+    {
+        double stageDurations[BENCHMARK_STAGE_COUNT];
+        auto frameStart = chrono::steady_clock::now();
+        auto stageStart = frameStart;
+        renderer.resetCounters();
+
+        // Clear buffers.
+        renderer.framebuffer.clear(camera.getNear(), camera.getFar());
+        stageDurations[(int)BenchmarkStage::CLEAR] = elapsedMs(stageStart);
+
+        // Render scene.
+        stageStart = chrono::steady_clock::now();
+        renderer.setProjection(camera.getPerspective());
+        renderer.setView(camera.getViewMat());
+        scene.update(init.render.deltaTime, renderer, camera);
+        stageDurations[(int)BenchmarkStage::DRAW] = elapsedMs(stageStart);
+
+        // Rasterize the triangles binned by the tiled backend.
+        stageStart = chrono::steady_clock::now();
+        renderer.flush();
+        stageDurations[(int)BenchmarkStage::FLUSH] = elapsedMs(stageStart);
+
+        // Resolve the color buffer, like before it is displayed.
+        stageStart = chrono::steady_clock::now();
+        renderer.framebuffer.getDisplayColors();
+        stageDurations[(int)BenchmarkStage::RESOLVE] = elapsedMs(stageStart);
+        stageDurations[(int)BenchmarkStage::FRAME]   = elapsedMs(frameStart);
+
+        // Only keep the timed frames.
+        if (frame < init.warmupCount) continue;
+        for (int i = 0; i < BENCHMARK_STAGE_COUNT; i++)
+            durations[i].push_back(stageDurations[i]);
+        triangles += renderer.getPipelineStats().trianglesRasterized;
+    }
+
+    // Compute the statistics and throughputs over the total duration of the timed frames.
+    SceneResults results;
+    results.scene             = _scene;
+    results.trianglesPerFrame = init.render.frameCount > 0 ? (int)(triangles / init.render.frameCount) : 0;
+    for (int i = 0; i < BENCHMARK_STAGE_COUNT; i++)
+        results.stages[i] = computeStats(durations[i]);
+
+    const double totalSeconds = results.stages[(int)BenchmarkStage::FRAME].mean * init.render.frameCount / 1000;
+    results.trianglesPerSecond = totalSeconds > 0 ? triangles / totalSeconds : 0;
+    results.pixelsPerSecond    = totalSeconds > 0 ? (double)init.render.width * init.render.height * init.render.frameCount / totalSeconds : 0;
+    return results;
+}
+
+bool Benchmark::writeResults(const vector<SceneResults>& _results, const RasterKernel& _kernel) const
+{
+    // Open the output.
+    const bool toStdout = string(init.render.outputPath) == "-";
+    FILE*      file     = toStdout ? stdout : fopen(init.render.outputPath, "w");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Unable to open %s.\n", init.render.outputPath);
+        return false;
+    }
+
+    // Write the configuration.
+    fprintf(file, "{\n");
+    fprintf(file, "  \"width\": %d,\n  \"height\": %d,\n", init.render.width, init.render.height);
+    fprintf(file, "  \"frames\": %d,\n  \"warmupFrames\": %d,\n", init.render.frameCount, init.warmupCount);
+    fprintf(file, "  \"renderMode\": \"%s\",\n",   renderModeNames    [(int)init.render.renderMode]);
+    fprintf(file, "  \"lightingMode\": \"%s\",\n", lightingModeNames  [(int)init.render.lightingMode]);
+    fprintf(file, "  \"pipeline\": \"%s\",\n",     renderPipelineNames[(int)init.render.renderPipeline]);
+    fprintf(file, "  \"backend\": \"%s\",\n",      rasterBackendNames [(int)init.render.rasterBackend]);
+    fprintf(file, "  \"kernel\": \"%s\",\n",       kernelNames        [(int)_kernel]);
+
+    // Write the results of each scene (durations are in milliseconds).
+    fprintf(file, "  \"scenes\": [\n");
+    for (size_t i = 0; i < _results.size(); i++)
+    {
+        const SceneResults& results = _results[i];
+        fprintf(file, "    {\n");
+        fprintf(file, "      \"name\": \"%s\",\n", scenePresetNames[(int)results.scene]);
+        fprintf(file, "      \"trianglesPerFrame\": %d,\n", results.trianglesPerFrame);
+        fprintf(file, "      \"trianglesPerSecond\": %.0f,\n", results.trianglesPerSecond);
+        fprintf(file, "      \"pixelsPerSecond\": %.0f,\n", results.pixelsPerSecond);
+        fprintf(file, "      \"stagesMs\": {\n");
+        for (int stage = 0; stage < BENCHMARK_STAGE_COUNT; stage++)
+        {
+            const StageStats& stats = results.stages[stage];
+            fprintf(file, "        \"%s\": { \"min\": %.4f, \"median\": %.4f, \"p99\": %.4f, \"mean\": %.4f }%s\n",
+                    stageNames[stage], stats.min, stats.median, stats.p99, stats.mean, stage + 1 < BENCHMARK_STAGE_COUNT ? "," : "");
+        }
+        fprintf(file, "      }\n");
+        fprintf(file, "    }%s\n", i + 1 < _results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    const bool written = ferror(file) == 0;
+    if (toStdout) fflush(file);
+    else          fclose(file);
+    return written;
+}
+
+bool Benchmark::run()
+{
+    // Benchmark the scenes one after the other.
+    vector<SceneResults> results;
+    for (int scene = 0; scene < SCENE_PRESET_COUNT; scene++)
+    {
+        if (!init.allScenes && scene != (int)init.render.scene) continue;
+        fprintf(stderr, "Benchmarking the %s scene...\n", scenePresetNames[scene]);
+        results.push_back(runScene((ScenePreset)scene));
+    }
+
+    // The raster kernel is the best one of the CPU, like in the app.
+    return writeResults(results, getBestRasterKernel());
+}
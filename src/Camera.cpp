@@ -1,5 +1,7 @@
 
+#ifndef HEADLESS
 #include <imgui.h>
+#endif
 #include <my_math.hpp>
 #include <Camera.hpp>
 #include <cstdio>
@@ -144,6 +146,7 @@ void Camera::setLookAtRotation()
     setRotation(camToTarget.getAngleTheta(), camToTarget.getAnglePhi());
 }
 
+#ifndef HEADLESS
 void Camera::showImGuiControls()
 {
     // Compute items padding.
@@ -179,4 +182,5 @@ void Camera::showImGuiControls()
     ImGui::DragFloat("Speed", &acceleration, 0.05, 0.05, 10);
 
     ImGui::EndGroup();
-}
\ No newline at end of file
+}
+#endif
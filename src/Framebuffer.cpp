@@ -1,41 +1,280 @@
+#include <cmath>
 #include <cstring>
+#include <algorithm>
 
 #include "Framebuffer.hpp"
 
+// ---- sRGB conversion tables ---- //
+
+const std::array<float, 256> Framebuffer::srgbToLinear = []
+{
+    std::array<float, 256> table;
+    for (int i = 0; i < 256; i++)
+    {
+        float srgb = i / 255.f;
+        table[i] = srgb <= 0.04045f ? srgb / 12.92f : powf((srgb + 0.055f) / 1.055f, 2.4f);
+    }
+    return table;
+}();
+
+const std::array<uint8_t, SRGB_ENCODE_SIZE> Framebuffer::linearToSRGB = []
+{
+    std::array<uint8_t, SRGB_ENCODE_SIZE> table;
+    for (int i = 0; i < SRGB_ENCODE_SIZE; i++)
+    {
+        float linear = (float)i / (SRGB_ENCODE_SIZE - 1);
+        table[i] = (uint8_t)floatToUnorm(linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1 / 2.4f) - 0.055f, 255);
+    }
+    return table;
+}();
+
+// ---- Framebuffer ---- //
+
 Framebuffer::Framebuffer(const int& _width, const int& _height)
     : width(_width)
     , height(_height)
+    , tilesX((_width + FRAMEBUFFER_TILE_SIZE - 1) / FRAMEBUFFER_TILE_SIZE)
+    , bufferSize(_width * _height)
+    , tilesY((_height + FRAMEBUFFER_TILE_SIZE - 1) / FRAMEBUFFER_TILE_SIZE)
 {
     // Create the framebuffer (color+depth+opengl texture).
-    // We need an OpenGL texture to display the result of the renderer to the screen.
+    // We need an OpenGL texture to display the result of the renderer to the screen (headless builds have none).
 
     // Load the color and depth buffers.
-    colorBuffer.reserve(_width * _height);
-    depthBuffer.reserve(_width * _height);
+    packedColorBuffer.reserve(_width * _height);
+    depthBuffer      .reserve(_width * _height);
 
+#ifndef HEADLESS
     // Load the texture.
     glGenTextures(1, &colorTexture);
     glBindTexture(GL_TEXTURE_2D, colorTexture);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+#endif
 }
 
 Framebuffer::~Framebuffer()
 {
+#ifndef HEADLESS
     glDeleteTextures(1, &colorTexture);
+#endif
+}
+
+uint32_t Framebuffer::packClearColor() const
+{
+    switch (colorFormat)
+    {
+    case ColorFormat::RGBA8:    return packColor<ColorFormat::RGBA8>   (frameClearColor);
+    case ColorFormat::SRGB8_A8: return packColor<ColorFormat::SRGB8_A8>(frameClearColor);
+    default:                    return 0;
+    }
+}
+
+void Framebuffer::clear(const float& _zNear, const float& _zFar)
+{
+    // Make sure the buffers are allocated (this only writes to them when their size changes).
+    if (colorFormat == ColorFormat::RGBA32F) colorBuffer      .resize(bufferSize);
+    else                                     packedColorBuffer.resize(bufferSize);
+    switch (depthFormat)
+    {
+    case DepthFormat::UNORM16: depthBuffer16.resize(bufferSize); break;
+    case DepthFormat::UNORM24: depthBuffer24.resize(bufferSize); break;
+    default:                   depthBuffer  .resize(bufferSize); break;
+    }
+
+    // Save the clear values and mark every tile as cleared.
+    depthNear        = _zNear;
+    depthFar         = _zFar;
+    invDepthRange    = _zFar > _zNear ? 1 / (_zFar - _zNear) : 1;
+    frameClearColor  = clearColor;
+    packedClearColor = packClearColor();
+    pendingClears.assign(tilesX * tilesY, TILE_CLEAR_COLOR | TILE_CLEAR_DEPTH);
+}
+
+void Framebuffer::fillTile(const int& _tile, const uint8_t& _buffers)
+{
+    // Get the tile's pixels (padding pixels of tiled buffers are filled too).
+    const int x    = (_tile % tilesX) * FRAMEBUFFER_TILE_SIZE;
+    const int y    = (_tile / tilesX) * FRAMEBUFFER_TILE_SIZE;
+    const int cols = layout == FramebufferLayout::TILED ? FRAMEBUFFER_TILE_SIZE : std::min(FRAMEBUFFER_TILE_SIZE, width  - x);
+    const int rows = layout == FramebufferLayout::TILED ? FRAMEBUFFER_TILE_SIZE : std::min(FRAMEBUFFER_TILE_SIZE, height - y);
+
+    // Fill the tile row by row.
+    for (int row = 0; row < rows; row++)
+    {
+        const int index = getIndex(x, y + row);
+        if (_buffers & TILE_CLEAR_COLOR)
+        {
+            if (colorFormat == ColorFormat::RGBA32F) std::fill_n(&colorBuffer      [index], cols, frameClearColor);
+            else                                     std::fill_n(&packedColorBuffer[index], cols, packedClearColor);
+        }
+        if (_buffers & TILE_CLEAR_DEPTH)
+        {
+            // Every format is cleared to the far plane.
+            switch (depthFormat)
+            {
+            case DepthFormat::FLOAT32:          std::fill_n(&depthBuffer  [index], cols, depthFar);             break;
+            case DepthFormat::FLOAT32_REVERSED: std::fill_n(&depthBuffer  [index], cols, depthNear / depthFar); break;
+            case DepthFormat::UNORM16:          std::fill_n(&depthBuffer16[index], cols, (uint16_t)0xFFFF);     break;
+            case DepthFormat::UNORM24:          std::fill_n(&depthBuffer24[index], cols, 0xFFFFFFu);            break;
+            }
+        }
+    }
+    pendingClears[_tile] &= ~_buffers;
+}
+
+void Framebuffer::setColorFormat(const ColorFormat& _format)
+{
+    if (_format == colorFormat) return;
+    colorFormat = _format;
+
+    // Free the buffer of the previous format, and clear the new one.
+    if (colorFormat == ColorFormat::RGBA32F)
+    {
+        std::vector<uint32_t>().swap(packedColorBuffer);
+        colorBuffer.resize(bufferSize);
+    }
+    else
+    {
+        std::vector<Color>().swap(colorBuffer);
+        packedColorBuffer.resize(bufferSize);
+    }
+    packedClearColor = packClearColor();
+    for (uint8_t& pendingClear : pendingClears)
+        pendingClear |= TILE_CLEAR_COLOR;
+}
+
+void Framebuffer::setDepthFormat(const DepthFormat& _format)
+{
+    if (_format == depthFormat) return;
+    depthFormat = _format;
+
+    // Free the buffers of the other formats, and clear the new one.
+    if (depthFormat != DepthFormat::UNORM16) std::vector<uint16_t>().swap(depthBuffer16);
+    if (depthFormat != DepthFormat::UNORM24) std::vector<uint32_t>().swap(depthBuffer24);
+    switch (depthFormat)
+    {
+    case DepthFormat::UNORM16: std::vector<float>().swap(depthBuffer); depthBuffer16.resize(bufferSize); break;
+    case DepthFormat::UNORM24: std::vector<float>().swap(depthBuffer); depthBuffer24.resize(bufferSize); break;
+    default:                                                           depthBuffer  .resize(bufferSize); break;
+    }
+    for (uint8_t& pendingClear : pendingClears)
+        pendingClear |= TILE_CLEAR_DEPTH;
+}
+
+void Framebuffer::setLayout(const FramebufferLayout& _layout)
+{
+    if (_layout == layout) return;
+    layout = _layout;
+
+    // Tiled buffers are padded to whole tiles.
+    if (layout == FramebufferLayout::TILED)
+        bufferSize = tilesX * FRAMEBUFFER_TILE_SIZE * ((height + FRAMEBUFFER_TILE_SIZE - 1) / FRAMEBUFFER_TILE_SIZE) * FRAMEBUFFER_TILE_SIZE;
+    else
+        bufferSize = width * height;
+
+    // The previous contents don't make sense in the new layout.
+    clear(depthNear, depthFar);
+}
+
+// Copies a tiled buffer to a row-major one. Tiles whose color hasn't been cleared yet are copied as the clear value.
+template<typename T>
+static void detile(const std::vector<T>& _tiled, std::vector<T>& _linear, const int& _width, const int& _height, const int& _tilesX,
+                   const std::vector<uint8_t>& _pendingClears, const T& _clearValue)
+{
+    _linear.resize(_width * _height);
+    for (int y = 0; y < _height; y++)
+    {
+        const int tileY   = y / FRAMEBUFFER_TILE_SIZE;
+        const T*  tileRow = &_tiled[tileY * _tilesX * FRAMEBUFFER_TILE_SIZE * FRAMEBUFFER_TILE_SIZE + (y % FRAMEBUFFER_TILE_SIZE) * FRAMEBUFFER_TILE_SIZE];
+        for (int x = 0; x < _width; x += FRAMEBUFFER_TILE_SIZE, tileRow += FRAMEBUFFER_TILE_SIZE * FRAMEBUFFER_TILE_SIZE)
+        {
+            const int count = std::min(FRAMEBUFFER_TILE_SIZE, _width - x);
+            if (_pendingClears[tileY * _tilesX + x / FRAMEBUFFER_TILE_SIZE] & TILE_CLEAR_COLOR)
+                std::fill_n(&_linear[y * _width + x], count, _clearValue);
+            else
+                memcpy(&_linear[y * _width + x], tileRow, count * sizeof(T));
+        }
+    }
 }
 
-void Framebuffer::clear(const int& zFar)
+Color Framebuffer::getPixelColor(const int& _x, const int& _y) const
 {
-    // Clear color and depth buffer
-    colorBuffer.assign(width * height, clearColor);
-    depthBuffer.assign(width * height, zFar);
+    // Tiles that haven't been drawn to hold the clear color.
+    const int  index   = getIndex(_x, _y);
+    const bool cleared = pendingClears[(_y / FRAMEBUFFER_TILE_SIZE) * tilesX + _x / FRAMEBUFFER_TILE_SIZE] & TILE_CLEAR_COLOR;
+    switch (colorFormat)
+    {
+    case ColorFormat::RGBA8:    return cleared ? unpackColor<ColorFormat::RGBA8>   (packedClearColor) : readColor<ColorFormat::RGBA8>   (index);
+    case ColorFormat::SRGB8_A8: return cleared ? unpackColor<ColorFormat::SRGB8_A8>(packedClearColor) : readColor<ColorFormat::SRGB8_A8>(index);
+    default:                    return cleared ? frameClearColor                                      : readColor<ColorFormat::RGBA32F> (index);
+    }
 }
 
+const void* Framebuffer::getDisplayColors()
+{
+    // De-tile the color buffer (the tiles that were never drawn to are resolved to the clear color on the way).
+    if (layout == FramebufferLayout::TILED)
+    {
+        if (colorFormat == ColorFormat::RGBA32F) { detile(colorBuffer,       linearColors,       width, height, tilesX, pendingClears, frameClearColor);  return linearColors.data();       }
+        else                                     { detile(packedColorBuffer, linearPackedColors, width, height, tilesX, pendingClears, packedClearColor); return linearPackedColors.data(); }
+    }
+
+    // Linear buffers are displayed as they are: fill the color of the tiles that were never drawn to.
+    for (int tile = 0; tile < (int)pendingClears.size(); tile++)
+        if (pendingClears[tile] & TILE_CLEAR_COLOR)
+            fillTile(tile, TILE_CLEAR_COLOR);
+    if (colorFormat == ColorFormat::RGBA32F) return colorBuffer.data();
+    else                                     return packedColorBuffer.data();
+}
+
+#ifndef HEADLESS
 void Framebuffer::updateTexture()
 {
-    // Reload the texture.
+    const void* colors = getDisplayColors();
+
+    // Reload the texture (8-bit formats are uploaded as they are: sRGB values are meant for the screen).
     glBindTexture(GL_TEXTURE_2D, colorTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, colorBuffer.data());
+    if (colorFormat == ColorFormat::RGBA32F)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, colors);
+    else
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, colors);
+}
+#endif
+
+void Framebuffer::getDisplayRGB(std::vector<uint8_t>& _rgb)
+{
+    const void* colors = getDisplayColors();
+
+    // 8-bit formats are copied as they are, like they are displayed.
+    _rgb.resize(width * height * 3);
+    for (int i = 0; i < width * height; i++)
+    {
+        if (colorFormat == ColorFormat::RGBA32F)
+        {
+            const Color& color = ((const Color*)colors)[i];
+            _rgb[i * 3 + 0] = (uint8_t)floatToUnorm(color.r, 255);
+            _rgb[i * 3 + 1] = (uint8_t)floatToUnorm(color.g, 255);
+            _rgb[i * 3 + 2] = (uint8_t)floatToUnorm(color.b, 255);
+        }
+        else
+        {
+            const uint32_t packed = ((const uint32_t*)colors)[i];
+            _rgb[i * 3 + 0] = (uint8_t)(packed);
+            _rgb[i * 3 + 1] = (uint8_t)(packed >> 8);
+            _rgb[i * 3 + 2] = (uint8_t)(packed >> 16);
+        }
+    }
+}
+
+bool Framebuffer::writePPM(FILE* _file)
+{
+    std::vector<uint8_t> rgb;
+    getDisplayRGB(rgb);
+
+    // Write the header and the rgb bytes.
+    fprintf(_file, "P6\n%d %d\n255\n", width, height);
+    fwrite(rgb.data(), 1, rgb.size(), _file);
+    return ferror(_file) == 0;
 }
@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "HeadlessApp.hpp"
+#include "Renderer.hpp"
+#include "Camera.hpp"
+#include "Scene.hpp"
+#include "Profiler.hpp"
+
+const char* const scenePresetNames   [SCENE_PRESET_COUNT] = { "default", "spheres", "translucent", "textured" };
+const char* const renderModeNames    [4]                  = { "unlit", "lit", "wireframe", "zbuffer" };
+const char* const lightingModeNames  [2]                  = { "phong", "blinn" };
+const char* const renderPipelineNames[3]                  = { "forward", "prepass", "visibility" };
+const char* const rasterBackendNames [2]                  = { "immediate", "tiled" };
+
+// Returns the index of _value in _names, or -1.
+static int findName(const char* _value, const char* const* _names, const int& _count)
+{
+    for (int i = 0; i < _count; i++)
+        if (strcmp(_value, _names[i]) == 0) return i;
+    return -1;
+}
+
+bool parseHeadlessOption(const char& _option, const char* _value, HeadlessInit& _init)
+{
+    int index = 0;
+    switch (_option)
+    {
+    case 'w': _init.width      = atoi(_value); return _init.width  > 0;
+    case 'h': _init.height     = atoi(_value); return _init.height > 0;
+    case 'n': _init.frameCount = atoi(_value); return _init.frameCount >= 0;
+    case 'o': _init.outputPath = _value;       return true;
+    case 's': index = findName(_value, scenePresetNames,    SCENE_PRESET_COUNT); _init.scene          = (ScenePreset)   index; break;
+    case 'm': index = findName(_value, renderModeNames,     4);                  _init.renderMode     = (RenderMode)    index; break;
+    case 'l': index = findName(_value, lightingModeNames,   2);                  _init.lightingMode   = (LightingMode)  index; break;
+    case 'p': index = findName(_value, renderPipelineNames, 3);                  _init.renderPipeline = (RenderPipeline)index; break;
+    case 'b': index = findName(_value, rasterBackendNames,  2);                  _init.rasterBackend  = (RasterBackend) index; break;
+    default:  return false;
+    }
+    return index >= 0;
+}
+
+HeadlessApp::HeadlessApp(const HeadlessInit& _init)
+    : init(_init)
+{
+}
+
+bool HeadlessApp::writeFrame(Framebuffer& _framebuffer, const int& _frame) const
+{
+    if (init.outputPath == nullptr) return true;
+
+    // All of the frames go to stdout, one after the other.
+    std::string path = init.outputPath;
+    if (path == "-")
+    {
+        bool written = _framebuffer.writePPM(stdout);
+        fflush(stdout);
+        return written;
+    }
+
+    // Put the frame index in the file name.
+    size_t indexPos = path.find("%d");
+    if (indexPos != std::string::npos)
+        path.replace(indexPos, 2, std::to_string(_frame));
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Unable to open %s.\n", path.c_str());
+        return false;
+    }
+    bool written = _framebuffer.writePPM(file);
+    fclose(file);
+    return written;
+}
+
+bool HeadlessApp::update()
+{
+    // Initialize app objects (same camera as the windowed app).
+    Scene scene(init.scene);
+
+    Renderer renderer(init.width, init.height, scene.getLights());
+    renderer.setRenderMode    (init.renderMode);
+    renderer.setLightingMode  (init.lightingMode);
+    renderer.setRenderPipeline(init.renderPipeline);
+    renderer.setRasterBackend (init.rasterBackend);
+
+    Camera camera(renderer.framebuffer.getWidth(), renderer.framebuffer.getHeight(), 90.f, 0.001f, 1000.f, 2.5f);
+
+    // Trace the chosen frames (the profiler counts them from the next one).
+    profiler::setThreadName("Main");
+    if (init.tracePath != nullptr)
+        profiler::startTrace(init.tracePath, profiler::getFrameNumber() + 1 + init.traceFirst, init.traceCount);
+
+    // Write the pipeline statistics of every frame.
+    if (init.statsPath != nullptr && !renderer.startStatsCSV(init.statsPath))
+        return false;
+
+    for (int frame = 0; frame < init.frameCount; frame++)
+    {
+        // Move the profiled zones of the last frame to the histograms.
+        profiler::newFrame();
+
+        // Reset the renderer's counters (writing the statistics of the last frame).
+        renderer.resetCounters();
+
+        // Clear buffers.
+        {
+            PROFILE_SCOPE(ProfileZone::CLEAR);
+            renderer.framebuffer.clear(camera.getNear(), camera.getFar());
+        }
+
+        // Setup matrices.
+        renderer.setProjection(camera.getPerspective());
+        renderer.setView(camera.getViewMat());
+
+        // Render scene.
+        {
+            PROFILE_SCOPE(ProfileZone::SCENE);
+            scene.update(init.deltaTime, renderer, camera);
+        }
+
+        // Rasterize the triangles binned by the tiled backend.
+        {
+            PROFILE_SCOPE(ProfileZone::FLUSH);
+            renderer.flush();
+        }
+
+        // Write the frame.
+        PROFILE_SCOPE(ProfileZone::PRESENT);
+        if (!writeFrame(renderer.framebuffer, frame)) return false;
+    }
+
+    // End the last frame, and write the trace if its range goes past it.
+    renderer.stopStatsCSV();
+    profiler::newFrame();
+    return profiler::stopTrace();
+}
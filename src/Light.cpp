@@ -1,4 +1,3 @@
-#include <imgui.h>
 #include <my_math.hpp>
 
 #include <Light.hpp>
@@ -0,0 +1,84 @@
+#include "PipelineStats.hpp"
+
+using namespace std;
+
+// Columns of the CSV files, in the order of the fields.
+static const struct { const char* name; int PipelineStats::* field; } statColumns[] =
+{
+    { "pixels",               &PipelineStats::pixels               },
+    { "verticesTransformed",  &PipelineStats::verticesTransformed  },
+    { "lightingComputations", &PipelineStats::lightingComputations },
+    { "trianglesSubmitted",   &PipelineStats::trianglesSubmitted   },
+    { "backfaceCulled",       &PipelineStats::backfaceCulled       },
+    { "clippedTriangles",     &PipelineStats::clippedTriangles     },
+    { "clipCulled",           &PipelineStats::clipCulled           },
+    { "frustumCulled",        &PipelineStats::frustumCulled        },
+    { "zeroAreaCulled",       &PipelineStats::zeroAreaCulled       },
+    { "trianglesRasterized",  &PipelineStats::trianglesRasterized  },
+    { "smallTriangles",       &PipelineStats::smallTriangles       },
+    { "skippedBlocks",        &PipelineStats::skippedBlocks        },
+    { "partialBlocks",        &PipelineStats::partialBlocks        },
+    { "coveredBlocks",        &PipelineStats::coveredBlocks        },
+    { "fragmentsTested",      &PipelineStats::fragmentsTested      },
+    { "fragmentsPassed",      &PipelineStats::fragmentsPassed      },
+    { "earlyDepthKills",      &PipelineStats::earlyDepthKills      },
+    { "fragmentsShaded",      &PipelineStats::fragmentsShaded      },
+    { "fragmentsBlended",     &PipelineStats::fragmentsBlended     },
+    { "textureSamples",       &PipelineStats::textureSamples       },
+};
+
+PipelineStats& PipelineStats::operator+=(const PipelineStats& _stats)
+{
+    for (const auto& column : statColumns)
+        if (column.field != &PipelineStats::pixels) this->*column.field += _stats.*column.field;
+    return *this;
+}
+
+float PipelineStats::getOverdraw() const
+{
+    return pixels > 0 ? (float)fragmentsShaded / pixels : 0;
+}
+
+PipelineStatsCSV::~PipelineStatsCSV()
+{
+    close();
+}
+
+bool PipelineStatsCSV::open(const string& _path)
+{
+    close();
+    file = fopen(_path.c_str(), "w");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Unable to open %s.\n", _path.c_str());
+        return false;
+    }
+
+    // Frame index, the counters and the overdraw.
+    fprintf(file, "frame");
+    for (const auto& column : statColumns)
+        fprintf(file, ",%s", column.name);
+    fprintf(file, ",overdraw\n");
+    frame = 0;
+    return ferror(file) == 0;
+}
+
+void PipelineStatsCSV::close()
+{
+    if (file == nullptr) return;
+    fclose(file);
+    file = nullptr;
+}
+
+bool PipelineStatsCSV::isOpen() const { return file != nullptr; }
+
+bool PipelineStatsCSV::writeFrame(const PipelineStats& _stats)
+{
+    if (file == nullptr) return false;
+
+    fprintf(file, "%d", frame++);
+    for (const auto& column : statColumns)
+        fprintf(file, ",%d", _stats.*column.field);
+    fprintf(file, ",%.3f\n", _stats.getOverdraw());
+    return ferror(file) == 0;
+}
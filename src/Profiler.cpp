@@ -0,0 +1,282 @@
+#include <mutex>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <cstdio>
+#include <climits>
+
+#ifndef HEADLESS
+#include <imgui.h>
+#endif
+
+#include "Profiler.hpp"
+
+using namespace std;
+
+const char* const profiler::zoneNames[PROFILE_ZONE_COUNT] = { "Camera", "Clear", "Scene", "Shape", "Vertex transforms", "Vertex shading",
+                                                              "Triangles", "Tiles", "Resolve", "Flush", "Present", "ImGui" };
+
+const char* const profiler::zoneArgNames[PROFILE_ZONE_COUNT][2] =
+{
+    { nullptr,  nullptr     }, // Camera.
+    { nullptr,  nullptr     }, // Clear.
+    { nullptr,  nullptr     }, // Scene.
+    { "shape",  "triangles" }, // Shape.
+    { "vertices", nullptr   }, // Vertex transforms.
+    { nullptr,  nullptr     }, // Vertex shading.
+    { nullptr,  nullptr     }, // Triangles.
+    { "tile",   "triangles" }, // Tiles.
+    { nullptr,  nullptr     }, // Resolve.
+    { nullptr,  nullptr     }, // Flush.
+    { nullptr,  nullptr     }, // Present.
+    { nullptr,  nullptr     }, // ImGui.
+};
+
+// Profiles of every thread that recorded a zone (they are kept when their thread exits).
+static mutex                             threadsMutex;
+static vector<unique_ptr<ThreadProfile>> threads;
+
+// Tick rate calibration: a tick and steady_clock time taken at startup, compared with newer ones at each frame.
+static const uint64_t                          baseTicks = profiler::now();
+static const chrono::steady_clock::time_point  baseTime  = chrono::steady_clock::now();
+static double                                  ticksPerMs = 0;
+
+// Zone durations (ms) of the last frames, zone counts of the last frame, and the frame durations.
+static float    zoneHistory[PROFILE_ZONE_COUNT][PROFILER_HISTORY] = {};
+static int      zoneCounts [PROFILE_ZONE_COUNT] = {};
+static float    frameHistory[PROFILER_HISTORY] = {};
+static int      frameIndex     = 0;
+static int      frameNumber    = -1;
+static uint64_t frameStartTick = 0;
+
+// Frame recorded in a trace, by the thread that called newFrame.
+struct TracedFrame
+{
+    int      number, thread;
+    uint64_t start,  end;
+};
+
+// Trace capture: the inclusive range of traced frames and their events, with the index of their thread.
+static bool                               tracing    = false;
+static string                             tracePath;
+static int                                traceFirst = 0, traceLast = 0;
+static vector<TracedFrame>                tracedFrames;
+static vector<pair<int, ProfileEvent>>    tracedEvents;
+static uint64_t                           droppedEvents = 0;
+static string                             traceStatus;
+
+ThreadProfile* profiler::registerThread()
+{
+    lock_guard<mutex> lock(threadsMutex);
+    threads.push_back(make_unique<ThreadProfile>((int)threads.size()));
+    return threads.back().get();
+}
+
+void profiler::setThreadName(const string& _name)
+{
+    ThreadProfile& profile = getThreadProfile();
+    lock_guard<mutex> lock(threadsMutex);
+    profile.name = _name;
+}
+
+double profiler::ticksToMs(const uint64_t& _ticks)
+{
+    if (ticksPerMs <= 0)
+    {
+        // Wait for a few milliseconds to pass since startup to get a precise rate.
+        double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - baseTime).count();
+        if (elapsedMs < 1) return 0;
+        return (double)_ticks * elapsedMs / (double)(now() - baseTicks);
+    }
+    return (double)_ticks / ticksPerMs;
+}
+
+void profiler::newFrame()
+{
+    // Refine the tick rate as time passes.
+    uint64_t tick      = now();
+    double   elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - baseTime).count();
+    if (elapsedMs >= 10) ticksPerMs = (double)(tick - baseTicks) / elapsedMs;
+
+    // Sum the zones of every thread and start them over.
+    uint64_t totals[PROFILE_ZONE_COUNT] = {};
+    int      counts[PROFILE_ZONE_COUNT] = {};
+    bool     traced = tracing && frameNumber >= traceFirst && frameNumber <= traceLast;
+    int      caller = getThreadProfile().index;
+    {
+        lock_guard<mutex> lock(threadsMutex);
+        for (unique_ptr<ThreadProfile>& thread : threads)
+        {
+            for (int i = 0; i < PROFILE_ZONE_COUNT; i++)
+            {
+                totals[i]     += thread->totals[i];
+                counts[i]     += thread->counts[i];
+                thread->totals[i] = 0;
+                thread->counts[i] = 0;
+            }
+
+            // Read the frame's events, the ones that were overwritten are lost.
+            uint64_t first = max(thread->readCount, thread->eventCount > PROFILER_RING_SIZE ? thread->eventCount - PROFILER_RING_SIZE : 0);
+            if (traced)
+            {
+                droppedEvents += first - thread->readCount;
+                for (uint64_t i = first; i < thread->eventCount; i++)
+                    tracedEvents.push_back({ thread->index, thread->ring[i & (PROFILER_RING_SIZE - 1)] });
+            }
+            thread->readCount = thread->eventCount;
+        }
+    }
+    if (traced)
+        tracedFrames.push_back({ frameNumber, caller, frameStartTick, tick });
+
+    // Move them to the histograms (the first frame starts at the first call).
+    if (frameStartTick != 0)
+    {
+        frameIndex = (frameIndex + 1) % PROFILER_HISTORY;
+        for (int i = 0; i < PROFILE_ZONE_COUNT; i++)
+        {
+            zoneHistory[i][frameIndex] = (float)ticksToMs(totals[i]);
+            zoneCounts [i]             = counts[i];
+        }
+        frameHistory[frameIndex] = (float)ticksToMs(tick - frameStartTick);
+    }
+    frameStartTick = tick;
+
+    // Write the trace once its last frame is over.
+    if (tracing && frameNumber >= traceLast)
+        stopTrace();
+    frameNumber++;
+}
+
+int profiler::getFrameNumber() { return frameNumber; }
+
+void profiler::startTrace(const string& _path, const int& _firstFrame, const int& _frameCount)
+{
+    tracing    = true;
+    tracePath  = _path;
+    traceFirst = _firstFrame;
+    traceLast  = _frameCount < 0 ? INT_MAX : _firstFrame + _frameCount - 1;
+    tracedFrames.clear();
+    tracedEvents.clear();
+    droppedEvents = 0;
+    traceStatus   = "Tracing frames to " + tracePath + "...";
+}
+
+bool profiler::isTracing() { return tracing; }
+
+// Writes the microseconds between _origin and _tick.
+static void writeTraceTime(FILE* _file, const char* _key, const uint64_t& _origin, const uint64_t& _tick)
+{
+    double us = _tick >= _origin ? profiler::ticksToMs(_tick - _origin) * 1000 : -profiler::ticksToMs(_origin - _tick) * 1000;
+    fprintf(_file, "\"%s\": %.3f", _key, us);
+}
+
+bool profiler::stopTrace()
+{
+    if (!tracing) return true;
+    tracing = false;
+
+    FILE* file = fopen(tracePath.c_str(), "w");
+    if (file == nullptr)
+    {
+        traceStatus = "Unable to open " + tracePath + ".";
+        fprintf(stderr, "%s\n", traceStatus.c_str());
+        return false;
+    }
+
+    // Name the threads.
+    fprintf(file, "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [\n");
+    {
+        lock_guard<mutex> lock(threadsMutex);
+        for (const unique_ptr<ThreadProfile>& thread : threads)
+            fprintf(file, "    { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": { \"name\": \"%s\" } },\n",
+                    thread->index, thread->name.c_str());
+    }
+
+    // Times are relative to the start of the first traced frame.
+    uint64_t origin = tracedFrames.empty() ? 0 : tracedFrames[0].start;
+    for (const TracedFrame& frame : tracedFrames)
+    {
+        fprintf(file, "    { \"name\": \"Frame\", \"cat\": \"frame\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, ", frame.thread);
+        writeTraceTime(file, "ts",  origin, frame.start);
+        fprintf(file, ", ");
+        writeTraceTime(file, "dur", frame.start, frame.end);
+        fprintf(file, ", \"args\": { \"frame\": %d } },\n", frame.number);
+    }
+    for (const pair<int, ProfileEvent>& traced : tracedEvents)
+    {
+        const ProfileEvent& event = traced.second;
+        fprintf(file, "    { \"name\": \"%s\", \"cat\": \"zone\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, ", zoneNames[(int)event.zone], traced.first);
+        writeTraceTime(file, "ts",  origin, event.start);
+        fprintf(file, ", ");
+        writeTraceTime(file, "dur", event.start, event.end);
+
+        // Zone arguments.
+        fprintf(file, ", \"args\": {");
+        for (int i = 0, written = 0; i < 2; i++)
+        {
+            const char* argName = zoneArgNames[(int)event.zone][i];
+            if (argName != nullptr) fprintf(file, "%s \"%s\": %d", written++ > 0 ? "," : "", argName, event.args[i]);
+        }
+        fprintf(file, " } },\n");
+    }
+
+    // Metadata event that ends the list (JSON has no trailing commas).
+    fprintf(file, "    { \"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": { \"name\": \"Rasterizer\" } }\n  ]\n}\n");
+    bool written = ferror(file) == 0;
+    fclose(file);
+
+    // Report the events that didn't fit in the ring buffers.
+    traceStatus = "Wrote " + to_string(tracedFrames.size()) + " frames to " + tracePath + ".";
+    if (droppedEvents > 0)
+    {
+        traceStatus += " " + to_string(droppedEvents) + " events were dropped.";
+        fprintf(stderr, "%s\n", traceStatus.c_str());
+    }
+    tracedFrames.clear();
+    tracedEvents.clear();
+    return written;
+}
+
+float profiler::getZoneTime (const ProfileZone& _zone) { return zoneHistory[(int)_zone][frameIndex]; }
+int   profiler::getZoneCount(const ProfileZone& _zone) { return zoneCounts[(int)_zone]; }
+float profiler::getFrameTime()                         { return frameHistory[frameIndex]; }
+
+#ifndef HEADLESS
+// Plots the values of the last frames, starting with the oldest one (nothing if they are all 0).
+static void plotHistory(const char* _label, const float* _history, const char* _overlay, const float& _height)
+{
+    float maxValue = 0;
+    for (int i = 0; i < PROFILER_HISTORY; i++) maxValue = max(maxValue, _history[i]);
+    if (maxValue <= 0) return;
+
+    ImGui::PlotHistogram(_label, _history, PROFILER_HISTORY, (frameIndex + 1) % PROFILER_HISTORY, _overlay, 0, maxValue, { 0, _height });
+}
+
+void profiler::showImGuiControls()
+{
+    char overlay[64];
+    snprintf(overlay, sizeof(overlay), "%.2f ms", getFrameTime());
+    plotHistory("Frame", frameHistory, overlay, 50);
+
+#if PROFILER
+    for (int i = 0; i < PROFILE_ZONE_COUNT; i++)
+    {
+        // Zones that weren't hit during the last frames are hidden.
+        snprintf(overlay, sizeof(overlay), "%.3f ms (%d)", zoneHistory[i][frameIndex], zoneCounts[i]);
+        plotHistory(zoneNames[i], zoneHistory[i], overlay, 30);
+    }
+#else
+    ImGui::Text("Zones are compiled out (build with PROFILER=1).");
+#endif
+
+    // Trace the next frames.
+    static int traceFrameCount = 10;
+    ImGui::Separator();
+    if (ImGui::InputInt("Traced frames", &traceFrameCount)) traceFrameCount = max(1, traceFrameCount);
+    if (!tracing && ImGui::Button("Write trace.json"))
+        startTrace("trace.json", frameNumber + 1, traceFrameCount);
+    if (!traceStatus.empty())
+        ImGui::Text("%s", traceStatus.c_str());
+}
+#endif
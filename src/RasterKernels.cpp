@@ -0,0 +1,262 @@
+#include <cmath>
+
+#include "Renderer.hpp"
+#include "RasterKernels.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define RASTER_KERNELS_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+// ---------- Scalar kernel ---------- //
+
+// COVERAGE tests the pixels against the edges, covered blocks only interpolate them.
+template<typename T, bool COVERAGE>
+static int spanScalarT(const TriangleSetup& _setup, T _w0, T _w1, T _w2, int _count, SpanValues& _values)
+{
+    const Vector3* perspectiveUV = _setup.perspectiveUV;
+
+    int mask = 0;
+    for (int i = 0; i < _count; i++, _w0 += _setup.A12, _w1 += _setup.A20, _w2 += _setup.A01)
+    {
+        // Skip pixels that are outside of an edge.
+        if constexpr (COVERAGE)
+        {
+            if ((_w0 | _w1 | _w2) < 0) continue;
+            mask |= 1 << i;
+        }
+
+        // Transform the barycentric coordinates to percentages.
+        float w0n = (float)(_w0 - _setup.bias0) * _setup.invArea;
+        float w1n = (float)(_w1 - _setup.bias1) * _setup.invArea;
+        float w2n = (float)(_w2 - _setup.bias2) * _setup.invArea;
+
+        // Compute the pixel's depth and perspective-correct uvs.
+        float depth = 1 / fabsf(perspectiveUV[0].z * w0n + perspectiveUV[1].z * w1n + perspectiveUV[2].z * w2n);
+        _values.w0n  [i] = w0n;
+        _values.w1n  [i] = w1n;
+        _values.w2n  [i] = w2n;
+        _values.depth[i] = depth;
+        _values.u    [i] = depth * (perspectiveUV[0].x * w0n + perspectiveUV[1].x * w1n + perspectiveUV[2].x * w2n);
+        _values.v    [i] = depth * (perspectiveUV[0].y * w0n + perspectiveUV[1].y * w1n + perspectiveUV[2].y * w2n);
+    }
+    return mask;
+}
+
+static int spanScalar(const TriangleSetup& _setup, int _w0, int _w1, int _w2, int _count, SpanValues& _values)
+{
+    return spanScalarT<int, true>(_setup, _w0, _w1, _w2, _count, _values);
+}
+
+static void interpolateScalar(const TriangleSetup& _setup, int _w0, int _w1, int _w2, int _count, SpanValues& _values)
+{
+    spanScalarT<int, false>(_setup, _w0, _w1, _w2, _count, _values);
+}
+
+int spanScalarWide(const TriangleSetup& _setup, int64_t _w0, int64_t _w1, int64_t _w2, int _count, SpanValues& _values)
+{
+    return spanScalarT<int64_t, true>(_setup, _w0, _w1, _w2, _count, _values);
+}
+
+void interpolateScalarWide(const TriangleSetup& _setup, int64_t _w0, int64_t _w1, int64_t _w2, int _count, SpanValues& _values)
+{
+    spanScalarT<int64_t, false>(_setup, _w0, _w1, _w2, _count, _values);
+}
+
+#ifdef RASTER_KERNELS_X86
+
+// ------------ SSE kernel ----------- //
+
+static inline __m128 interpolate4(const float& _a, const float& _b, const float& _c, const __m128& _w0n, const __m128& _w1n, const __m128& _w2n)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(_a), _w0n), _mm_mul_ps(_mm_set1_ps(_b), _w1n)), _mm_mul_ps(_mm_set1_ps(_c), _w2n));
+}
+
+template<bool COVERAGE>
+static int spanSSET(const TriangleSetup& _setup, int _w0, int _w1, int _w2, int _count, SpanValues& _values)
+{
+    const Vector3* perspectiveUV = _setup.perspectiveUV;
+    const __m128   signMask      = _mm_set1_ps(-0.f);
+
+    int mask = 0;
+    for (int half = 0; half < SPAN_WIDTH; half += 4)
+    {
+        // Edge functions of the 4 pixels.
+        __m128i w0 = _mm_add_epi32(_mm_set1_epi32(_w0 + half * _setup.A12), _mm_setr_epi32(0, _setup.A12, 2 * _setup.A12, 3 * _setup.A12));
+        __m128i w1 = _mm_add_epi32(_mm_set1_epi32(_w1 + half * _setup.A20), _mm_setr_epi32(0, _setup.A20, 2 * _setup.A20, 3 * _setup.A20));
+        __m128i w2 = _mm_add_epi32(_mm_set1_epi32(_w2 + half * _setup.A01), _mm_setr_epi32(0, _setup.A01, 2 * _setup.A01, 3 * _setup.A01));
+
+        // Coverage test.
+        if constexpr (COVERAGE)
+        {
+            __m128i inside    = _mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(w0, w1), w2), _mm_set1_epi32(-1));
+            int     halfMask  = _mm_movemask_ps(_mm_castsi128_ps(inside));
+            mask |= halfMask << half;
+            if (halfMask == 0) continue;
+        }
+
+        // Transform the barycentric coordinates to percentages.
+        __m128 invArea = _mm_set1_ps(_setup.invArea);
+        __m128 w0n     = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(w0, _mm_set1_epi32(_setup.bias0))), invArea);
+        __m128 w1n     = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(w1, _mm_set1_epi32(_setup.bias1))), invArea);
+        __m128 w2n     = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(w2, _mm_set1_epi32(_setup.bias2))), invArea);
+
+        // Compute the pixels' depth and perspective-correct uvs.
+        __m128 invDepth = interpolate4(perspectiveUV[0].z, perspectiveUV[1].z, perspectiveUV[2].z, w0n, w1n, w2n);
+        __m128 depth    = _mm_div_ps(_mm_set1_ps(1), _mm_andnot_ps(signMask, invDepth));
+        __m128 u        = _mm_mul_ps(depth, interpolate4(perspectiveUV[0].x, perspectiveUV[1].x, perspectiveUV[2].x, w0n, w1n, w2n));
+        __m128 v        = _mm_mul_ps(depth, interpolate4(perspectiveUV[0].y, perspectiveUV[1].y, perspectiveUV[2].y, w0n, w1n, w2n));
+
+        _mm_store_ps(_values.w0n   + half, w0n);
+        _mm_store_ps(_values.w1n   + half, w1n);
+        _mm_store_ps(_values.w2n   + half, w2n);
+        _mm_store_ps(_values.depth + half, depth);
+        _mm_store_ps(_values.u     + half, u);
+        _mm_store_ps(_values.v     + half, v);
+    }
+    return mask & ((1 << _count) - 1);
+}
+
+static int spanSSE(const TriangleSetup& _setup, int _w0, int _w1, int _w2, int _count, SpanValues& _values)
+{
+    return spanSSET<true>(_setup, _w0, _w1, _w2, _count, _values);
+}
+
+static void interpolateSSE(const TriangleSetup& _setup, int _w0, int _w1, int _w2, int _count, SpanValues& _values)
+{
+    spanSSET<false>(_setup, _w0, _w1, _w2, _count, _values);
+}
+
+// ----------- AVX2 kernel ----------- //
+
+__attribute__((target("avx2")))
+static inline __m256 interpolate8(const float& _a, const float& _b, const float& _c, const __m256& _w0n, const __m256& _w1n, const __m256& _w2n)
+{
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(_a), _w0n), _mm256_mul_ps(_mm256_set1_ps(_b), _w1n)), _mm256_mul_ps(_mm256_set1_ps(_c), _w2n));
+}
+
+template<bool COVERAGE>
+__attribute__((target("avx2")))
+static int spanAVX2T(const TriangleSetup& _setup, int _w0, int _w1, int _w2, int _count, SpanValues& _values)
+{
+    const Vector3* perspectiveUV = _setup.perspectiveUV;
+    const __m256i  lanes         = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    // Edge functions of the 8 pixels.
+    __m256i w0 = _mm256_add_epi32(_mm256_set1_epi32(_w0), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(_setup.A12)));
+    __m256i w1 = _mm256_add_epi32(_mm256_set1_epi32(_w1), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(_setup.A20)));
+    __m256i w2 = _mm256_add_epi32(_mm256_set1_epi32(_w2), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(_setup.A01)));
+
+    // Coverage test.
+    int mask = 0;
+    if constexpr (COVERAGE)
+    {
+        __m256i inside = _mm256_cmpgt_epi32(_mm256_or_si256(_mm256_or_si256(w0, w1), w2), _mm256_set1_epi32(-1));
+        mask = _mm256_movemask_ps(_mm256_castsi256_ps(inside)) & ((1 << _count) - 1);
+        if (mask == 0) return 0;
+    }
+
+    // Transform the barycentric coordinates to percentages.
+    __m256 invArea = _mm256_set1_ps(_setup.invArea);
+    __m256 w0n     = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(w0, _mm256_set1_epi32(_setup.bias0))), invArea);
+    __m256 w1n     = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(w1, _mm256_set1_epi32(_setup.bias1))), invArea);
+    __m256 w2n     = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(w2, _mm256_set1_epi32(_setup.bias2))), invArea);
+
+    // Compute the pixels' depth and perspective-correct uvs.
+    __m256 invDepth = interpolate8(perspectiveUV[0].z, perspectiveUV[1].z, perspectiveUV[2].z, w0n, w1n, w2n);
+    __m256 depth    = _mm256_div_ps(_mm256_set1_ps(1), _mm256_andnot_ps(_mm256_set1_ps(-0.f), invDepth));
+    __m256 u        = _mm256_mul_ps(depth, interpolate8(perspectiveUV[0].x, perspectiveUV[1].x, perspectiveUV[2].x, w0n, w1n, w2n));
+    __m256 v        = _mm256_mul_ps(depth, interpolate8(perspectiveUV[0].y, perspectiveUV[1].y, perspectiveUV[2].y, w0n, w1n, w2n));
+
+    _mm256_store_ps(_values.w0n,   w0n);
+    _mm256_store_ps(_values.w1n,   w1n);
+    _mm256_store_ps(_values.w2n,   w2n);
+    _mm256_store_ps(_values.depth, depth);
+    _mm256_store_ps(_values.u,     u);
+    _mm256_store_ps(_values.v,     v);
+    return mask;
+}
+
+__attribute__((target("avx2")))
+static int spanAVX2(const TriangleSetup& _setup, int _w0, int _w1, int _w2, int _count, SpanValues& _values)
+{
+    return spanAVX2T<true>(_setup, _w0, _w1, _w2, _count, _values);
+}
+
+__attribute__((target("avx2")))
+static void interpolateAVX2(const TriangleSetup& _setup, int _w0, int _w1, int _w2, int _count, SpanValues& _values)
+{
+    spanAVX2T<false>(_setup, _w0, _w1, _w2, _count, _values);
+}
+
+// Checks CPUID and the OS-enabled register state for AVX2.
+static bool cpuHasAVX2()
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    // AVX and OSXSAVE support.
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    if (!(ecx & (1u << 27)) || !(ecx & (1u << 28))) return false;
+
+    // The OS must save the ymm registers.
+    unsigned int xcr0Low, xcr0High;
+    __asm__ volatile("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    if ((xcr0Low & 6) != 6) return false;
+
+    // AVX2 support.
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    return (ebx & (1u << 5)) != 0;
+}
+
+#endif
+
+// ------------- Dispatch ------------ //
+
+bool isRasterKernelSupported(const RasterKernel& _kernel)
+{
+    switch (_kernel)
+    {
+    case RasterKernel::SCALAR: return true;
+#ifdef RASTER_KERNELS_X86
+    case RasterKernel::SSE:  return true;
+    case RasterKernel::AVX2: { static const bool hasAVX2 = cpuHasAVX2(); return hasAVX2; }
+#endif
+    default: return false;
+    }
+}
+
+RasterKernel getBestRasterKernel()
+{
+    if (isRasterKernelSupported(RasterKernel::AVX2)) return RasterKernel::AVX2;
+    if (isRasterKernelSupported(RasterKernel::SSE))  return RasterKernel::SSE;
+    return RasterKernel::SCALAR;
+}
+
+SpanKernel getSpanKernel(const RasterKernel& _kernel)
+{
+    if (!isRasterKernelSupported(_kernel)) return spanScalar;
+
+    switch (_kernel)
+    {
+#ifdef RASTER_KERNELS_X86
+    case RasterKernel::SSE:  return spanSSE;
+    case RasterKernel::AVX2: return spanAVX2;
+#endif
+    default: return spanScalar;
+    }
+}
+
+SpanInterpolator getSpanInterpolator(const RasterKernel& _kernel)
+{
+    if (!isRasterKernelSupported(_kernel)) return interpolateScalar;
+
+    switch (_kernel)
+    {
+#ifdef RASTER_KERNELS_X86
+    case RasterKernel::SSE:  return interpolateSSE;
+    case RasterKernel::AVX2: return interpolateAVX2;
+#endif
+    default: return interpolateScalar;
+    }
+}
@@ -0,0 +1,354 @@
+#include <cstdio>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#include "Regression.hpp"
+#include "Renderer.hpp"
+#include "Camera.hpp"
+#include "Scene.hpp"
+
+using namespace std;
+
+// Frames rendered before the compared one, so that the state kept between frames is exercised.
+#define REGRESSION_WARMUP_FRAMES 3
+
+// Reference scenes: every render and lighting mode, the alpha-blended shapes of the default and translucent scenes,
+// and each raster kernel, color format, depth format and memory layout.
+static const RegressionCase regressionCases[] =
+{
+    { "default-unlit",            ScenePreset::DEFAULT,            RenderMode::UNLIT,     LightingMode::PHONG },
+    { "default-phong",            ScenePreset::DEFAULT,            RenderMode::LIT,       LightingMode::PHONG },
+    { "default-blinn",            ScenePreset::DEFAULT,            RenderMode::LIT,       LightingMode::BLINN },
+    { "default-wireframe",        ScenePreset::DEFAULT,            RenderMode::WIREFRAME, LightingMode::PHONG },
+    { "default-zbuffer",          ScenePreset::DEFAULT,            RenderMode::ZBUFFER,   LightingMode::PHONG },
+    { "translucent-phong",        ScenePreset::TRANSLUCENT_STACKS, RenderMode::LIT,       LightingMode::PHONG },
+    { "translucent-blinn",        ScenePreset::TRANSLUCENT_STACKS, RenderMode::LIT,       LightingMode::BLINN },
+    { "translucent-zbuffer",      ScenePreset::TRANSLUCENT_STACKS, RenderMode::ZBUFFER,   LightingMode::PHONG },
+    { "textured-phong",           ScenePreset::TEXTURED_CUBES,     RenderMode::LIT,       LightingMode::PHONG },
+    { "spheres-blinn",            ScenePreset::SPHERE_WALL,        RenderMode::LIT,       LightingMode::BLINN },
+
+    // Raster kernels (the cases above use the best one of the CPU).
+    { "default-phong-scalar",     ScenePreset::DEFAULT,            RenderMode::LIT,       LightingMode::PHONG, RasterKernel::SCALAR },
+    { "default-phong-sse",        ScenePreset::DEFAULT,            RenderMode::LIT,       LightingMode::PHONG, RasterKernel::SSE },
+    { "default-phong-avx2",       ScenePreset::DEFAULT,            RenderMode::LIT,       LightingMode::PHONG, RasterKernel::AVX2 },
+    { "textured-phong-scalar",    ScenePreset::TEXTURED_CUBES,     RenderMode::LIT,       LightingMode::PHONG, RasterKernel::SCALAR },
+
+    // Color formats.
+    { "translucent-phong-srgb",   ScenePreset::TRANSLUCENT_STACKS, RenderMode::LIT,       LightingMode::PHONG, getBestRasterKernel(), ColorFormat::SRGB8_A8 },
+    { "translucent-phong-hdr",    ScenePreset::TRANSLUCENT_STACKS, RenderMode::LIT,       LightingMode::PHONG, getBestRasterKernel(), ColorFormat::RGBA32F },
+    { "textured-phong-srgb",      ScenePreset::TEXTURED_CUBES,     RenderMode::LIT,       LightingMode::PHONG, getBestRasterKernel(), ColorFormat::SRGB8_A8 },
+
+    // Depth formats.
+    { "default-phong-reversed",   ScenePreset::DEFAULT,            RenderMode::LIT,       LightingMode::PHONG, getBestRasterKernel(), ColorFormat::RGBA8,   DepthFormat::FLOAT32_REVERSED },
+    { "default-phong-depth16",    ScenePreset::DEFAULT,            RenderMode::LIT,       LightingMode::PHONG, getBestRasterKernel(), ColorFormat::RGBA8,   DepthFormat::UNORM16 },
+    { "default-phong-depth24",    ScenePreset::DEFAULT,            RenderMode::LIT,       LightingMode::PHONG, getBestRasterKernel(), ColorFormat::RGBA8,   DepthFormat::UNORM24 },
+    { "default-zbuffer-depth16",  ScenePreset::DEFAULT,            RenderMode::ZBUFFER,   LightingMode::PHONG, getBestRasterKernel(), ColorFormat::RGBA8,   DepthFormat::UNORM16 },
+    { "spheres-blinn-reversed",   ScenePreset::SPHERE_WALL,        RenderMode::LIT,       LightingMode::BLINN, getBestRasterKernel(), ColorFormat::RGBA8,   DepthFormat::FLOAT32_REVERSED },
+
+    // Tiled memory layout.
+    { "default-phong-tiled",      ScenePreset::DEFAULT,            RenderMode::LIT,       LightingMode::PHONG, getBestRasterKernel(), ColorFormat::RGBA8,   DepthFormat::FLOAT32,         FramebufferLayout::TILED },
+    { "translucent-phong-tiled",  ScenePreset::TRANSLUCENT_STACKS, RenderMode::LIT,       LightingMode::PHONG, getBestRasterKernel(), ColorFormat::RGBA8,   DepthFormat::FLOAT32,         FramebufferLayout::TILED },
+    { "textured-blinn-hdr-tiled", ScenePreset::TEXTURED_CUBES,     RenderMode::LIT,       LightingMode::BLINN, getBestRasterKernel(), ColorFormat::RGBA32F, DepthFormat::UNORM24,         FramebufferLayout::TILED },
+};
+
+// Returns the baseline file of this machine (the frame times can't be compared between machines).
+static string getMachineBaselinePath()
+{
+    char host[256] = "unknown";
+#ifdef _WIN32
+    if (const char* name = getenv("COMPUTERNAME")) snprintf(host, sizeof(host), "%s", name);
+#else
+    if (gethostname(host, sizeof(host)) != 0) snprintf(host, sizeof(host), "unknown");
+    host[sizeof(host) - 1] = '\0';
+#endif
+    return string("regression/baseline/") + host + ".txt";
+}
+
+// Creates the directory of a file if it doesn't exist.
+static void makeParentDirectory(const string& _path)
+{
+    size_t separator = _path.find_last_of('/');
+    if (separator == string::npos) return;
+#ifdef _WIN32
+    _mkdir(_path.substr(0, separator).c_str());
+#else
+    mkdir(_path.substr(0, separator).c_str(), 0755);
+#endif
+}
+
+// Reads a binary PPM image written by Framebuffer::writePPM. Returns false if it is missing or isn't _width x _height.
+static bool readPPM(const string& _path, const int& _width, const int& _height, vector<uint8_t>& _rgb)
+{
+    FILE* file = fopen(_path.c_str(), "rb");
+    if (file == nullptr) return false;
+
+    int width = 0, height = 0, maxValue = 0;
+    bool valid = fscanf(file, "P6 %d %d %d", &width, &height, &maxValue) == 3 && fgetc(file) != EOF &&
+                 width == _width && height == _height && maxValue == 255;
+    if (valid)
+    {
+        _rgb.resize(width * height * 3);
+        valid = fread(_rgb.data(), 1, _rgb.size(), file) == _rgb.size();
+    }
+    fclose(file);
+    return valid;
+}
+
+static bool writePPM(const string& _path, const int& _width, const int& _height, const vector<uint8_t>& _rgb)
+{
+    FILE* file = fopen(_path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Unable to open %s.\n", _path.c_str());
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", _width, _height);
+    fwrite(_rgb.data(), 1, _rgb.size(), file);
+    bool written = ferror(file) == 0;
+    fclose(file);
+    return written;
+}
+
+Regression::Regression(const RegressionInit& _init)
+    : init(_init)
+    , baselinePath(_init.baselinePath != nullptr ? _init.baselinePath : getMachineBaselinePath())
+{
+}
+
+double Regression::render(const RegressionCase& _case, const RenderPipeline& _pipeline, const RasterBackend& _backend, vector<uint8_t>& _rgb, const bool& _timed) const
+{
+    // Initialize the scene and renderer like the headless app.
+    Scene scene(_case.scene);
+
+    Renderer renderer(init.width, init.height, scene.getLights());
+    renderer.setRenderMode    (_case.renderMode);
+    renderer.setLightingMode  (_case.lightingMode);
+    renderer.setRenderPipeline(_pipeline);
+    renderer.setRasterBackend (_backend);
+    renderer.setRasterKernel  (_case.kernel);
+    renderer.framebuffer.setColorFormat(_case.colorFormat);
+    renderer.framebuffer.setDepthFormat(_case.depthFormat);
+    renderer.framebuffer.setLayout     (_case.layout);
+
+    Camera camera(renderer.framebuffer.getWidth(), renderer.framebuffer.getHeight(), 90.f, 0.001f, 1000.f, 2.5f);
+    auto renderFrame = [&]()
+    {
+        renderer.resetCounters();
+        renderer.framebuffer.clear(camera.getNear(), camera.getFar());
+        renderer.setProjection(camera.getPerspective());
+        renderer.setView(camera.getViewMat());
+        scene.update(1 / 60.f, renderer, camera);
+        renderer.flush();
+    };
+
+    // The compared frame is always the same one.
+    for (int frame = 0; frame <= REGRESSION_WARMUP_FRAMES; frame++)
+        renderFrame();
+    renderer.framebuffer.getDisplayRGB(_rgb);
+    if (!_timed) return 0;
+
+    // Time batches of frames, and keep the best frame time (the least disturbed by the rest of the machine).
+    double bestMs = 0;
+    for (int sample = 0; sample < max(1, init.sampleCount); sample++)
+    {
+        auto   batchStart = chrono::steady_clock::now();
+        double batchMs    = 0;
+        int    frameCount = 0;
+        do
+        {
+            renderFrame();
+            frameCount++;
+            batchMs = chrono::duration<double, milli>(chrono::steady_clock::now() - batchStart).count();
+        }
+        while (batchMs < init.batchMs);
+
+        double frameMs = batchMs / frameCount;
+        bestMs = sample == 0 ? frameMs : min(bestMs, frameMs);
+    }
+    return bestMs;
+}
+
+int Regression::findDifferences(const vector<uint8_t>& _rgb, const vector<uint8_t>& _golden, vector<int>& _differences) const
+{
+    const int pixelCount = init.width * init.height;
+    _differences.assign(pixelCount, 0);
+
+    int failedPixels = 0;
+    for (int i = 0; i < pixelCount; i++)
+    {
+        for (int c = 0; c < 3; c++)
+            _differences[i] = max(_differences[i], abs((int)_rgb[i * 3 + c] - (int)_golden[i * 3 + c]));
+        if (_differences[i] > init.tolerance) failedPixels++;
+    }
+    return failedPixels;
+}
+
+bool Regression::compare(const string& _name, const vector<uint8_t>& _rgb, const vector<uint8_t>& _golden) const
+{
+    const int   pixelCount = init.width * init.height;
+    vector<int> differences;
+    int         failedPixels = findDifferences(_rgb, _golden, differences);
+    if (failedPixels == 0) return true;
+    int maxDifference = *max_element(differences.begin(), differences.end());
+
+    // Heatmap of the differences: the golden image darkened where they are equal, blue within the tolerance,
+    // and from red to yellow beyond it.
+    vector<uint8_t> heatmap(pixelCount * 3);
+    for (int i = 0; i < pixelCount; i++)
+    {
+        uint8_t* pixel = &heatmap[i * 3];
+        if (differences[i] == 0)
+        {
+            uint8_t gray = (uint8_t)((_golden[i * 3] + _golden[i * 3 + 1] + _golden[i * 3 + 2]) / 12);
+            pixel[0] = pixel[1] = pixel[2] = gray;
+        }
+        else if (differences[i] <= init.tolerance)
+        {
+            pixel[0] = 0; pixel[1] = 0; pixel[2] = 255;
+        }
+        else
+        {
+            pixel[0] = 255; pixel[1] = (uint8_t)min(255, differences[i] * 2); pixel[2] = 0;
+        }
+    }
+
+    // Write the render next to its heatmap.
+    const string path = string(init.outputDir) + "/" + _name;
+    writePPM(path + ".ppm",      init.width, init.height, _rgb);
+    writePPM(path + "-diff.ppm", init.width, init.height, heatmap);
+    printf("  FAIL %-40s %d pixels over the tolerance (max difference %d), see %s-diff.ppm\n", _name.c_str(), failedPixels, maxDifference, path.c_str());
+    return false;
+}
+
+bool Regression::getGolden(const RegressionCase& _case, const RenderPipeline& _pipeline, vector<uint8_t>& _golden) const
+{
+    const string path = string(init.goldenDir) + "/" + _case.name + "-" + renderPipelineNames[(int)_pipeline] + ".ppm";
+
+    // Use the pipeline's own golden image if it has one.
+    vector<uint8_t> own;
+    if (!init.update)
+    {
+        if (readPPM(path, init.width, init.height, own)) _golden.swap(own);
+        return true;
+    }
+
+    // Only store the pipeline's render if it doesn't match the previous golden image.
+    vector<int> differences;
+    render(_case, _pipeline, RasterBackend::IMMEDIATE, own, false);
+    if (findDifferences(own, _golden, differences) == 0)
+    {
+        remove(path.c_str());
+        return true;
+    }
+    printf("  The %s pipeline has its own golden image.\n", renderPipelineNames[(int)_pipeline]);
+    _golden.swap(own);
+    return writePPM(path, init.width, init.height, _golden);
+}
+
+bool Regression::readBaseline()
+{
+    FILE* file = fopen(baselinePath.c_str(), "r");
+    if (file == nullptr) return false;
+
+    // Each line holds the name of a render and its best frame time.
+    char   name[128];
+    double ms;
+    while (fscanf(file, "%127s %lf", name, &ms) == 2)
+        baseline[name] = ms;
+    fclose(file);
+    return true;
+}
+
+bool Regression::writeBaseline(const map<string, double>& _times) const
+{
+    makeParentDirectory(baselinePath);
+    FILE* file = fopen(baselinePath.c_str(), "w");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Unable to open %s.\n", baselinePath.c_str());
+        return false;
+    }
+    for (const pair<const string, double>& time : _times)
+        fprintf(file, "%s %.4f\n", time.first.c_str(), time.second);
+    bool written = ferror(file) == 0;
+    fclose(file);
+    return written;
+}
+
+bool Regression::run()
+{
+    // Without a baseline (on a new machine), this run's frame times become it.
+    const bool newBaseline = !init.update && !readBaseline();
+    if (newBaseline)
+        printf("No performance baseline in %s yet, this run's frame times are stored as the baseline.\n", baselinePath.c_str());
+
+    map<string, double> times;
+    int failedImages = 0, slowRenders = 0, renderCount = 0;
+    for (const RegressionCase& regressionCase : regressionCases)
+    {
+        printf("%s\n", regressionCase.name);
+        if (!isRasterKernelSupported(regressionCase.kernel))
+        {
+            printf("  SKIP the raster kernel isn't supported by this CPU\n");
+            continue;
+        }
+
+        // The reference golden image is rendered by the forward pipeline and the immediate backend.
+        vector<uint8_t> golden, rgb;
+        const string    goldenPath = string(init.goldenDir) + "/" + regressionCase.name + ".ppm";
+        if (init.update)
+        {
+            render(regressionCase, RenderPipeline::FORWARD, RasterBackend::IMMEDIATE, golden, false);
+            if (!writePPM(goldenPath, init.width, init.height, golden)) return false;
+        }
+        else if (!readPPM(goldenPath, init.width, init.height, golden))
+        {
+            printf("  FAIL missing or invalid golden image %s (run make regress-update)\n", goldenPath.c_str());
+            failedImages++;
+            continue;
+        }
+
+        // Every backend must match the golden image of the pipeline.
+        for (int pipeline = 0; pipeline < 3; pipeline++)
+        {
+            if (pipeline > 0 && !getGolden(regressionCase, (RenderPipeline)pipeline, golden)) return false;
+            for (int backend = 0; backend < 2; backend++)
+            {
+                const string name = string(regressionCase.name) + "-" + renderPipelineNames[pipeline] + "-" + rasterBackendNames[backend];
+                const double ms   = render(regressionCase, (RenderPipeline)pipeline, (RasterBackend)backend, rgb, true);
+                times[name] = ms;
+                renderCount++;
+
+                if (!compare(name, rgb, golden)) failedImages++;
+
+                // Flag the renders that got slower than the baseline.
+                auto baselineTime = baseline.find(name);
+                if (init.update || baselineTime == baseline.end()) continue;
+                if (ms > baselineTime->second * (1 + init.perfThreshold))
+                {
+                    printf("  SLOW %-40s %.3f ms instead of %.3f ms (+%.0f%%)\n", name.c_str(), ms, baselineTime->second, (ms / baselineTime->second - 1) * 100);
+                    slowRenders++;
+                }
+            }
+        }
+    }
+
+    if (init.update)
+    {
+        printf("Updated the golden images of %d renders in %s, and the baseline %s.\n", renderCount, init.goldenDir, baselinePath.c_str());
+        return writeBaseline(times) && failedImages == 0;
+    }
+    if (newBaseline && !writeBaseline(times))
+        return false;
+
+    printf("%d renders: %d images don't match, %d renders are slower than the baseline.\n", renderCount, failedImages, slowRenders);
+    return failedImages == 0 && slowRenders == 0;
+}
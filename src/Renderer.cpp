@@ -1,9 +1,12 @@
+#include <cmath>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <cassert>
-#include <ctime>
 
+#ifndef HEADLESS
 #include <imgui.h>
+#endif
 #include <my_math.hpp>
 
 #include "Light.hpp"
@@ -18,55 +21,53 @@ Renderer::Renderer(const unsigned int& _width, const unsigned int& _height, vect
         , lights(_lights)
         , framebuffer(_width, _height)
 {
-    renderMode   = RenderMode::LIT;
-    lightingMode = LightingMode::PHONG;
+    renderMode     = RenderMode::LIT;
+    lightingMode   = LightingMode::PHONG;
+    rasterBackend  = RasterBackend::IMMEDIATE;
+    renderPipeline = RenderPipeline::FORWARD;
+    renderPass     = RenderPass::FORWARD;
+    setRasterKernel(getBestRasterKernel());
+
+    // Create the tile bins used by the tiled backend.
+    tilesX = (_width  + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (_height + TILE_SIZE - 1) / TILE_SIZE;
+    tileBins.resize(tilesX * tilesY);
 }
 
 // -- Setters for the three matrices -- //
 
-void Renderer::setModel(const Mat4& _modelMatrix)           { modelMat.clear(); modelMat.push_back(_modelMatrix); }
-void Renderer::setView(const Mat4& _viewMatrix)             { viewMat = _viewMatrix;                              }
-void Renderer::setProjection(const Mat4& _projectionMatrix) { projectionMat = _projectionMatrix;                  }
+void Renderer::setModel(const Mat4& _modelMatrix)           { modelMat.clear(); modelMat.push_back(_modelMatrix); constantsDirty = true; }
+void Renderer::setView(const Mat4& _viewMatrix)             { viewMat = _viewMatrix; instanceDirty = true;        constantsDirty = true; }
+void Renderer::setProjection(const Mat4& _projectionMatrix) { projectionMat = _projectionMatrix;                  constantsDirty = true; }
 
 // ------- Model transformations ------ //
 
-void Renderer::modelPushMat  ()                                                                 { modelMat.push_back(modelMat.back());                                               }
-void Renderer::modelPopMat   ()                                                                 { if (modelMat.size() > 1) modelMat.pop_back();                                      }
-void Renderer::modelTranslate(const float& _x, const float& _y, const float& _z)                { modelMat.back() = getTranslationMatrix({ _x, _y, _z })          * modelMat.back(); }
-void Renderer::modelRotateX  (const float& _angle)                                              { modelMat.back() = getXRotationMatrix(_angle)                    * modelMat.back(); }
-void Renderer::modelRotateY  (const float& _angle)                                              { modelMat.back() = getYRotationMatrix(_angle)                    * modelMat.back(); }
-void Renderer::modelRotateZ  (const float& _angle)                                              { modelMat.back() = getZRotationMatrix(_angle)                    * modelMat.back(); }
-void Renderer::modelScale    (const float& _scaleX, const float& _scaleY, const float& _scaleZ) { modelMat.back() = getScaleMatrix({ _scaleX, _scaleY, _scaleZ }) * modelMat.back(); }
+void Renderer::modelPushMat  ()                                                                 { modelMat.push_back(modelMat.back());                                                                      }
+void Renderer::modelPopMat   ()                                                                 { if (modelMat.size() > 1) modelMat.pop_back();                                      constantsDirty = true; }
+void Renderer::modelTranslate(const float& _x, const float& _y, const float& _z)                { modelMat.back() = getTranslationMatrix({ _x, _y, _z })          * modelMat.back(); constantsDirty = true; }
+void Renderer::modelRotateX  (const float& _angle)                                              { modelMat.back() = getXRotationMatrix(_angle)                    * modelMat.back(); constantsDirty = true; }
+void Renderer::modelRotateY  (const float& _angle)                                              { modelMat.back() = getYRotationMatrix(_angle)                    * modelMat.back(); constantsDirty = true; }
+void Renderer::modelRotateZ  (const float& _angle)                                              { modelMat.back() = getZRotationMatrix(_angle)                    * modelMat.back(); constantsDirty = true; }
+void Renderer::modelScale    (const float& _scaleX, const float& _scaleY, const float& _scaleZ) { modelMat.back() = getScaleMatrix({ _scaleX, _scaleY, _scaleZ }) * modelMat.back(); constantsDirty = true; }
 
 // --------- Drawing functions -------- //
 
 void Renderer::drawPixel(const unsigned int& _x, const unsigned int& _y, const float& _depth, Color _color)
 {
-    int    index  = _y * framebuffer.getWidth() + _x;
-    float& bufferDepth = framebuffer.depthBuffer[index];
-    Color& bufferColor = framebuffer.colorBuffer[index];
-    bool   isCloser    = _depth < bufferDepth;
-
-    // Alpha blending.
-    bool blendAlpha = false;
-    if (_color.a <= 0.99 || bufferColor.a <= 0.99)
+    framebuffer.prepareTile(_x, _y);
+    int  index    = framebuffer.getIndex(_x, _y);
+    bool isCloser = framebuffer.depthLess(index, _depth);
+    bool depth    = renderMode == RenderMode::ZBUFFER;
+    bool blended  = false;
+    switch (framebuffer.getColorFormat())
     {
-        blendAlpha = true;
-        if (bufferColor.a > 0.99) blendAlpha = false;
-        float alpha = (isCloser ? _color.a : ((_color.a + 1 - bufferColor.a) / 2));
-        _color = _color * alpha + bufferColor * (1 - alpha);
-    }
-
-    // Draw the pixel (color or depth) if it is closer than the previous one.
-    if (isCloser || blendAlpha)
-    {
-        bufferDepth = _depth;
-        switch (renderMode)
-        {
-        case RenderMode::ZBUFFER:   bufferColor = { _depth, _depth, _depth, 1 }; break;
-        default:                    bufferColor = _color;                        break;
-        }
+    case ColorFormat::RGBA8:    blended = depth ? blendPixel<ColorFormat::RGBA8,    true, true>(index, isCloser, _depth, _color) : blendPixel<ColorFormat::RGBA8,    false, true>(index, isCloser, _depth, _color); break;
+    case ColorFormat::SRGB8_A8: blended = depth ? blendPixel<ColorFormat::SRGB8_A8, true, true>(index, isCloser, _depth, _color) : blendPixel<ColorFormat::SRGB8_A8, false, true>(index, isCloser, _depth, _color); break;
+    case ColorFormat::RGBA32F:  blended = depth ? blendPixel<ColorFormat::RGBA32F,  true, true>(index, isCloser, _depth, _color) : blendPixel<ColorFormat::RGBA32F,  false, true>(index, isCloser, _depth, _color); break;
     }
+    stats.fragmentsTested++;
+    stats.fragmentsPassed  += isCloser;
+    stats.fragmentsBlended += blended;
 }
 
 void Renderer::drawLine(const Vertex& _p0, const Vertex& _p1)
@@ -116,31 +117,36 @@ void Renderer::drawLine(const Vertex& _p0, const Vertex& _p1)
     }
 }
 
-static Vector3 ndcToScreenCoords(const Vector3& _ndc, const Viewport& _viewport)
+static Vector3 ndcToScreenCoords(const Vector3& _ndc, const DrawConstants& _constants)
 {
-    return { _ndc.x * _viewport.width  + _viewport.width  / 2, 
-             _ndc.y * _viewport.height + _viewport.height / 2, 
+    return { _ndc.x * _constants.viewportScale.x + _constants.viewportOffset.x, 
+             _ndc.y * _constants.viewportScale.y + _constants.viewportOffset.y, 
              _ndc.z };
 }
 
-static int barycentricCoords(const Vector3& _a, const Vector3& _b, const Vector3& _c)
+static int toFixedPoint(const float& _value)
 {
-    return (_b.x - _a.x) * (_c.y - _a.y) - (_b.y - _a.y) * (_c.x - _a.x);
+    return (int)lroundf(_value * SUBPIXEL_SCALE);
 }
 
-static void swapTriangleVertices(Vector3* _screenCoords, Vector4* _worldCoords, Vector4* _viewCoords, Vertex* _vertices)
+static int64_t edgeFunction(const int& _ax, const int& _ay, const int& _bx, const int& _by, const int64_t& _px, const int64_t& _py)
 {
-    // Get the triangle's sides and normals.
-    Vector2 p0p1(Vector2{ _screenCoords[0].x, _screenCoords[0].y }, Vector2{ _screenCoords[1].x, _screenCoords[1].y });
-    Vector2 p1p2(Vector2{ _screenCoords[1].x, _screenCoords[1].y }, Vector2{ _screenCoords[2].x, _screenCoords[2].y });
-    Vector2 p2p0(Vector2{ _screenCoords[2].x, _screenCoords[2].y }, Vector2{ _screenCoords[0].x, _screenCoords[0].y });
-    
-    // Calculate angles between the triangle's normals.
-    float angle0 = p0p1.getAngleWithVector2(p1p2.getNormal());
-    float angle1 = p2p0.getAngleWithVector2(p0p1.getNormal());
-    
-    // Check if the triangle is inside out.
-    if (angle0 < PI/2)
+    return (int64_t)(_bx - _ax) * (_py - _ay) - (int64_t)(_by - _ay) * (_px - _ax);
+}
+
+static int64_t signedArea(const Vector3* _screenCoords)
+{
+    int x0 = toFixedPoint(_screenCoords[0].x), y0 = toFixedPoint(_screenCoords[0].y);
+    int x1 = toFixedPoint(_screenCoords[1].x), y1 = toFixedPoint(_screenCoords[1].y);
+    int x2 = toFixedPoint(_screenCoords[2].x), y2 = toFixedPoint(_screenCoords[2].y);
+    return edgeFunction(x0, y0, x1, y1, x2, y2);
+}
+
+// Returns true if the vertices 0 and 1 were swapped.
+static bool swapTriangleVertices(Vector3* _screenCoords, Vector4* _worldCoords, float* _clipW, Vertex* _vertices)
+{
+    // Check if the triangle is inside out, using the same snapped coordinates as the rasterizer.
+    if (signedArea(_screenCoords) < 0)
     {
         // Swap position, depth and vertices.
         Vector3 tempVec  = _screenCoords[0];
@@ -151,33 +157,25 @@ static void swapTriangleVertices(Vector3* _screenCoords, Vector4* _worldCoords,
         _worldCoords[0]   = _worldCoords[1];
         _worldCoords[1]   = tempWorld;
         
-        float tempDepth  = _viewCoords[0].z;
-        _viewCoords[0].z = _viewCoords[1].z;
-        _viewCoords[1].z = tempDepth;
+        float tempDepth = _clipW[0];
+        _clipW[0]       = _clipW[1];
+        _clipW[1]       = tempDepth;
         
         Vertex tempVertex = _vertices[0];
         _vertices[0]      = _vertices[1];
         _vertices[1]      = tempVertex;
+        return true;
     }
-    else if (angle1 < PI/2)
-    {
-        // Swap position, depth and vertices.
-        Vector3 tempVec  = _screenCoords[2];
-        _screenCoords[2] = _screenCoords[0];
-        _screenCoords[0] = tempVec;
-
-        Vector4 tempWorld = _worldCoords[2];
-        _worldCoords[2]   = _worldCoords[0];
-        _worldCoords[0]   = tempWorld;
+    return false;
+}
 
-        float tempDepth  = _viewCoords[2].z;
-        _viewCoords[2].z = _viewCoords[0].z;
-        _viewCoords[0].z = tempDepth;
-        
-        Vertex tempVertex = _vertices[2];
-        _vertices[2]      = _vertices[0];
-        _vertices[0]      = tempVertex;
-    }
+// Top-left fill rule: pixels exactly on an edge are only drawn if it is a left edge or a top edge,
+// so that triangles sharing an edge never both draw its pixels.
+static int fillRuleBias(const int& _A, const int& _B)
+{
+    bool isLeft = _A > 0;
+    bool isTop  = _A == 0 && _B < 0;
+    return (isLeft || isTop) ? 0 : -1;
 }
 
 static bool isTowardsCamera(const Vector3& _worldPos, const Vector3& _worldNormal, const Vector3& _camPos)
@@ -185,45 +183,72 @@ static bool isTowardsCamera(const Vector3& _worldPos, const Vector3& _worldNorma
     return (_worldNormal & Vector3(_camPos, _worldPos)) <= 0;
 }
 
-bool Renderer::transformVertices(int _count, Vertex* _vertices, Vector3* _local, Vector4* _world, Vector4* _view, Vector4* _clip, Vector3* _ndc, Vector3* _screen, Vector3* _perspectiveUV)
+const DrawConstants& Renderer::getDrawConstants()
 {
-    for (int i = 0; i < _count; i++)
+    // Rebuild the constants if a matrix changed since the last draw.
+    if (constantsDirty)
     {
-        // Store triangle vertices positions.
+        Mat4 model = modelMat.back();
+        Mat4 view  = viewMat;
+
+        constants.model          = model;
+        constants.mvp            = model * viewMat * projectionMat;
+        constants.normal         = model.inv4().transpose();
+        constants.cameraPos      = (Vector4(0, 0, 0, 1) * view.inv4()).toVector3();
+        constants.viewportScale  = { (float)viewport.width,       (float)viewport.height       };
+        constants.viewportOffset = { (float)(viewport.width / 2), (float)(viewport.height / 2) };
+        constantsDirty = false;
+    }
+    return constants;
+}
+
+bool Renderer::transformVertices(int _count, Vertex* _vertices, Vector3* _local, Vector4* _world, Vector4* _clip)
+{
+    const DrawConstants& drawConstants = getDrawConstants();
+
+    // Store triangle vertices positions.
+    for (int i = 0; i < _count; i++)
         _local[i] = _vertices[i].pos;
-        
-        // Local space (3D) -> World space (3D).
-        _world[i] = Vector4{ _local[i], 1 } * modelMat.back();
-        
-        // World space (3D) -> View space (3D).
-        _view[i] = _world[i] * viewMat;
-        
-        // View space (3D) -> Clip space (4D).
-        _clip[i] = _view[i] * projectionMat;
 
-        // Clip triangles by nuking them when one vertex is offscreen.
-        if (!((-abs(_clip[i].w) <= _clip[i].x) && (_clip[i].x <= abs(_clip[i].w)) &&
-              (-abs(_clip[i].w) <= _clip[i].y) && (_clip[i].y <= abs(_clip[i].w)) &&
-              (-abs(_clip[i].w) <= _clip[i].z) && (_clip[i].z <= abs(_clip[i].w))))
-            return false;
-        
+    // Local space (3D) -> World space (3D), for lighting.
+    transformPoints(drawConstants.model, _local, _world, _count);
+
+    // Local space (3D) -> Clip space (4D), through the model-view-projection matrix.
+    transformPoints(drawConstants.mvp, _local, _clip, _count);
+
+    // Check if the vertices need to be clipped.
+    bool inside = true;
+    for (int i = 0; i < _count; i++)
+        inside = inside && isInsideClipVolume(_clip[i], getClipExtent());
+    return inside;
+}
+
+bool Renderer::projectVertices(Vertex* _vertices, Vector4* _world, const Vector4* _clip, Vector3* _ndc, Vector3* _screen, Vector3* _perspectiveUV)
+{
+    const DrawConstants& drawConstants = getDrawConstants();
+
+    float clipW[3];
+    for (int i = 0; i < 3; i++)
+    {
         // Clip space (4D) -> NDC (3D).
         _ndc[i] = _clip[i].toVector3(true);
         
         // NDC (3D) -> screen coords (2D).
-        _screen[i] = ndcToScreenCoords(_ndc[i], viewport);
+        _screen[i] = ndcToScreenCoords(_ndc[i], drawConstants);
+
+        // The clip w is the view depth.
+        clipW[i] = _clip[i].w;
     }
     
     // Make sure the triangle vertices are in the right order to be drawn.
-    swapTriangleVertices(_screen, _world, _view, _vertices);
+    bool swapped = swapTriangleVertices(_screen, _world, clipW, _vertices);
 
     for (int i = 0; i < 3; i++)
     {
         // Bring uv coords to clip space.
-        _perspectiveUV[i] = { _vertices[i].uv.x / _view[i].z, _vertices[i].uv.y / _view[i].z, 1 / _view[i].z };
+        _perspectiveUV[i] = { _vertices[i].uv.x / clipW[i], _vertices[i].uv.y / clipW[i], 1 / clipW[i] };
     }
-
-    return true;
+    return swapped;
 }
 
 bool Renderer::wireframeTriangle(Vector3* _screenCoords, Vertex* _vertices)
@@ -242,206 +267,637 @@ bool Renderer::wireframeTriangle(Vector3* _screenCoords, Vertex* _vertices)
     return false;
 }
 
+// Interpolates the attributes of a clipped vertex from the source triangle's vertices.
+static void interpolateClipVertex(const ClipVertex& _clipVertex, const Vertex* _vertices, const Vector4* _world,
+                                  Vertex& _vertex, Vector4& _worldCoords)
+{
+    const float w0 = _clipVertex.weights.x, w1 = _clipVertex.weights.y, w2 = _clipVertex.weights.z;
+
+    _vertex.pos    = _vertices[0].pos    * w0 + _vertices[1].pos    * w1 + _vertices[2].pos    * w2;
+    _vertex.normal = _vertices[0].normal * w0 + _vertices[1].normal * w1 + _vertices[2].normal * w2;
+    _vertex.color  = _vertices[0].color  * w0 + _vertices[1].color  * w1 + _vertices[2].color  * w2;
+    _vertex.uv     = _vertices[0].uv     * w0 + _vertices[1].uv     * w1 + _vertices[2].uv     * w2;
+    _worldCoords   = _world[0]           * w0 + _world[1]           * w1 + _world[2]           * w2;
+}
+
 void Renderer::drawTriangle(Triangle3 _triangle)
 {
-    Vector3 localCoords  [3];
-    Vector4 worldCoords  [3];
-    Vector4 viewCoords   [3];
-    Vector4 clipCoords   [3];
-    Vector3 ndcCoords    [3];
-    Vector3 screenCoords [3];
-    Vector3 perspectiveUV[3];
+    Vector3 localCoords[3];
+    Vector4 worldCoords[3];
+    Vector4 clipCoords [3];
+
+    const DrawConstants& drawConstants = getDrawConstants();
+    const Vector3&       cameraPos     = drawConstants.cameraPos;
 
     // Get the triangle's world position.
-    Vector3 trianglePos = (Vector4(_triangle.getCenterOfMass().pos, 1) * modelMat.back()).toVector3();
+    Vector3 trianglePos = (Vector4(_triangle.getCenterOfMass().pos, 1) * drawConstants.model).toVector3();
 
     // Get the triangle's normal in world coordinates.
     Vector3 worldNormal = (Vector4((_triangle.a.normal + _triangle.b.normal + _triangle.c.normal) / 3, 0)
-                        * modelMat.back()).toVector3().getNormalized();
-
-    // Get the camera's position.
-    Vector3 cameraPos = (Vector4(0, 0, 0, 1) * viewMat.inv4()).toVector3();
+                        * drawConstants.normal).toVector3().getNormalized();
 
     // Back face culling.
+    stats.trianglesSubmitted++;
     if (cullBackFaces && !isTowardsCamera(trianglePos, worldNormal, cameraPos)) 
+    {
+        stats.backfaceCulled++;
         return;
+    }
 
-    // Start a clock.
-    clock_t transformClock = clock();
+    // Transform the triangle's vertices through the renderer's matrices.
+    bool inside;
+    {
+        PROFILE_FINE_SCOPE(ProfileZone::TRANSFORM);
+        inside = transformVertices(3, &_triangle.a, localCoords, worldCoords, clipCoords);
+    }
+    stats.verticesTransformed += 3;
 
-    // Transform the triangle's vertices through the renderer's matrices and clip using clipCoords.w.
-    if (!transformVertices(3, &_triangle.a, localCoords, worldCoords, viewCoords, clipCoords, ndcCoords, screenCoords, perspectiveUV))
+    drawTransformedTriangle(&_triangle.a, worldCoords, clipCoords, inside, worldNormal, cameraPos);
+}
+
+void Renderer::drawTransformedTriangle(Vertex* _vertices, Vector4* _worldCoords, Vector4* _clipCoords, const bool& _inside,
+                                       const Vector3& _worldNormal, const Vector3& _cameraPos, const Color* _varyings)
+{
+    // Most triangles are entirely inside the clip volume.
+    if (_inside)
+    {
+        drawClipSpaceTriangle(_vertices, _worldCoords, _clipCoords, _worldNormal, _cameraPos, _varyings);
         return;
-    
-    // End the clock.
-    transformClock = clock() - transformClock;
-    transformDuration = (transformDuration + transformClock) / 2;
-    transformCounter += 3;
+    }
+
+    // Clip the triangle against the near and far planes and the guard band, and draw the resulting polygon as a fan of triangles.
+    ClipVertex clipped[MAX_CLIPPED_VERTICES];
+    int        clippedCount = clipHomogeneousTriangle(_clipCoords, clipped, getClipExtent());
+    stats.clippedTriangles++;
+    if (clippedCount < 3) stats.clipCulled++;
+    for (int i = 1; i < clippedCount - 1; i++)
+    {
+        const ClipVertex* fan[3] = { &clipped[0], &clipped[i], &clipped[i+1] };
+
+        Vertex  vertices   [3];
+        Vector4 fanWorld   [3];
+        Vector4 fanClip    [3];
+        Color   fanVaryings[3];
+        for (int j = 0; j < 3; j++)
+        {
+            interpolateClipVertex(*fan[j], _vertices, _worldCoords, vertices[j], fanWorld[j]);
+            fanClip[j] = fan[j]->pos;
+
+            // Interpolate the outputs of the vertex stage if it already ran.
+            if (_varyings != nullptr)
+                fanVaryings[j] = _varyings[0] * fan[j]->weights.x + _varyings[1] * fan[j]->weights.y + _varyings[2] * fan[j]->weights.z;
+        }
+        drawClipSpaceTriangle(vertices, fanWorld, fanClip, _worldNormal, _cameraPos, _varyings != nullptr ? fanVaryings : nullptr);
+    }
+}
+
+void Renderer::drawIndexed(const Vertex* _vertices, const unsigned int& _vertexCount, const uint32_t* _indices, const unsigned int& _indexCount)
+{
+    const DrawConstants& drawConstants = getDrawConstants();
+    const Vector3&       cameraPos     = drawConstants.cameraPos;
+
+    // The shader and render state are the same for the whole draw.
+    const ShaderProgram& shader   = getActiveShader();
+    const uint32_t       instance = getInstance(cameraPos);
+    const ShaderContext  context  = { *lights, instances[instance].material, instances[instance].cameraPos };
+    const bool           shade    = renderPass != RenderPass::DEPTH_ONLY && renderMode != RenderMode::WIREFRAME;
+
+    // Empty the post-transform cache.
+    vertexCache.assign(_vertexCount, TransformedVertex());
+
+    // Transform all the vertex positions at once, and check which ones need to be clipped.
+    {
+        PROFILE_NAMED_SCOPE(transformScope, ProfileZone::TRANSFORM);
+        PROFILE_SET_ARG(transformScope, 0, (int)_vertexCount);
+        localPositions.resize(_vertexCount);
+        worldPositions.resize(_vertexCount);
+        clipPositions .resize(_vertexCount);
+        for (unsigned int i = 0; i < _vertexCount; i++)
+            localPositions[i] = _vertices[i].pos;
+        transformPoints(drawConstants.model, localPositions.data(), worldPositions.data(), _vertexCount);
+        transformPoints(drawConstants.mvp,   localPositions.data(), clipPositions .data(), _vertexCount);
+        for (unsigned int i = 0; i < _vertexCount; i++)
+            vertexCache[i].inside = isInsideClipVolume(clipPositions[i], getClipExtent());
+    }
+    stats.verticesTransformed += _vertexCount;
+
+    for (unsigned int t = 0; t + 2 < _indexCount; t += 3)
+    {
+        Vertex             vertices[3] = { _vertices[_indices[t]], _vertices[_indices[t+1]], _vertices[_indices[t+2]] };
+        TransformedVertex* cached  [3] = { &vertexCache[_indices[t]], &vertexCache[_indices[t+1]], &vertexCache[_indices[t+2]] };
+
+        // Transform the normals that aren't in the cache yet.
+        for (int i = 0; i < 3; i++)
+        {
+            if (cached[i]->transformed) continue;
+            cached[i]->worldNormal = (Vector4(vertices[i].normal, 0) * drawConstants.normal).toVector3().getNormalized();
+            cached[i]->transformed = true;
+        }
+
+        // Get the triangle's normal in world coordinates.
+        Vector3 worldNormal = ((cached[0]->worldNormal + cached[1]->worldNormal + cached[2]->worldNormal) / 3).getNormalized();
+
+        // Back face culling: the vertex normals can be smoothed, so test the triangle's plane (facing the same side as its vertex normals).
+        Vector4 worldCoords[3] = { worldPositions[_indices[t]], worldPositions[_indices[t+1]], worldPositions[_indices[t+2]] };
+        Vector3 worldPos   [3] = { worldCoords[0].toVector3(), worldCoords[1].toVector3(), worldCoords[2].toVector3() };
+        Vector3 faceNormal  = Vector3(worldPos[0], worldPos[1]) ^ Vector3(worldPos[0], worldPos[2]);
+        if ((faceNormal & worldNormal) < 0) faceNormal.negate();
+        stats.trianglesSubmitted++;
+        if (cullBackFaces && !isTowardsCamera(worldPos[0], faceNormal, cameraPos))
+        {
+            stats.backfaceCulled++;
+            continue;
+        }
+
+        // Run the shader's vertex stage on the vertices that haven't been shaded yet, with their own normal.
+        if (shade && !(cached[0]->shaded && cached[1]->shaded && cached[2]->shaded))
+        {
+            PROFILE_FINE_SCOPE(ProfileZone::VERTEX_SHADING);
+            for (int i = 0; i < 3; i++)
+            {
+                if (cached[i]->shaded) continue;
+                cached[i]->varying = shader.vertexStage(context, { worldPos[i], cached[i]->worldNormal, vertices[i].color });
+                cached[i]->shaded  = true;
+
+                // Update the lighting counter if the vertex stage computed lighting.
+                if (shader.lighting == ShaderLighting::PER_VERTEX) stats.lightingComputations++;
+            }
+        }
+
+        // Gather the triangle's transformed vertices and draw it.
+        Vector4 clipCoords[3] = { clipPositions[_indices[t]], clipPositions[_indices[t+1]], clipPositions[_indices[t+2]] };
+        Color   varyings  [3] = { cached[0]->varying, cached[1]->varying, cached[2]->varying };
+        bool    inside         = cached[0]->inside && cached[1]->inside && cached[2]->inside;
+        drawTransformedTriangle(vertices, worldCoords, clipCoords, inside, worldNormal, cameraPos, varyings);
+    }
+}
+
+void Renderer::drawClipSpaceTriangle(Vertex* _vertices, Vector4* _worldCoords, const Vector4* _clipCoords,
+                                     const Vector3& _worldNormal, const Vector3& _cameraPos, const Color* _varyings)
+{
+    Vector3 ndcCoords    [3];
+    Vector3 screenCoords [3];
+    Vector3 perspectiveUV[3];
+
+    // Bring the vertices to screen space.
+    bool swapped = projectVertices(_vertices, _worldCoords, _clipCoords, ndcCoords, screenCoords, perspectiveUV);
 
     // Draw triangle wireframe
-    if (wireframeTriangle(screenCoords, &_triangle.a)) 
+    if (wireframeTriangle(screenCoords, _vertices)) 
+        return;
+
+    // Set the triangle's edges up, and don't go further if it misses all pixel centers.
+    TriangleSetup setup;
+    if (!setupEdges(screenCoords, setup))
         return;
+    stats.trianglesRasterized++;
+    if (setup.isSmall) stats.smallTriangles++;
 
-    // Increment the triangle counter.
-    triangleCounter++;
+    // Get the shader and render state of the triangle.
+    const ShaderProgram& shader   = getActiveShader();
+    const uint32_t       instance = getInstance(_cameraPos);
 
-    // Compute Blinn-Phong lighting for each vertex and light.
-    Color lightIntensity[3] = { { 1, 1, 1, 1 }, { 1, 1, 1, 1 }, { 1, 1, 1, 1 }, };
-    if (lightingMode == LightingMode::PHONG && renderMode == RenderMode::LIT)
+    // Run the shader's vertex stage on each vertex, unless the indexed draw already did.
+    Color varyings[3] = { { 1, 1, 1, 1 }, { 1, 1, 1, 1 }, { 1, 1, 1, 1 }, };
+    if (_varyings != nullptr)
     {
-        // Start a clock.
-        clock_t lightingClock = clock();
+        // Follow the vertices if they were swapped.
+        varyings[0] = _varyings[swapped ? 1 : 0];
+        varyings[1] = _varyings[swapped ? 0 : 1];
+        varyings[2] = _varyings[2];
+    }
+    else if (renderPass != RenderPass::DEPTH_ONLY)
+    {
+        PROFILE_FINE_SCOPE(ProfileZone::VERTEX_SHADING);
+        const ShaderContext context = { *lights, instances[instance].material, instances[instance].cameraPos };
+        for (int i = 0; i < 3; i++)
+            varyings[i] = shader.vertexStage(context, { _worldCoords[i].toVector3(), _worldNormal, _vertices[i].color });
+
+        // Update the lighting counter if the vertex stage computed lighting.
+        if (shader.lighting == ShaderLighting::PER_VERTEX)
+            stats.lightingComputations += 3;
+    }
 
-        // Calculate lights.
-        for (int i = 0; i < 3; i++, lightingCounter++)
-            lightIntensity[i] = computePhong(*lights, material, worldCoords[i].toVector3(), worldNormal, cameraPos);
-        
-        // End the clock.
-        lightingClock = clock() - lightingClock;
+    // Measure the duration of triangle drawing (binning in the tiled backend).
+    PROFILE_FINE_SCOPE(ProfileZone::TRIANGLE);
 
-        // Update the lighting duration.
-        lightingDuration = (lightingDuration + lightingClock) / 2;
+    // Store everything the rasterizer needs.
+    for (int i = 0; i < 3; i++)
+    {
+        setup.perspectiveUV[i] = perspectiveUV[i];
+        setup.worldCoords  [i] = _worldCoords [i];
+        setup.vertexColors [i] = _vertices[i].color;
+        setup.varyings     [i] = varyings[i];
+    }
+    setup.worldNormal = _worldNormal;
+    setup.instance    = instance;
 
+    // Pick the pixel pipeline of the pass and render state.
+    const bool opaque = _vertices[0].color.a > 0.99 && _vertices[1].color.a > 0.99 && _vertices[2].color.a > 0.99;
+    switch (renderPass)
+    {
+    case RenderPass::DEPTH_ONLY:  setup.pixelPipeline = &Renderer::depthSpan;                                                   break;
+    case RenderPass::DEPTH_EQUAL: setup.pixelPipeline = getPixelPipeline(shader, instances[instance], opaque, DepthTest::EQUAL);  break;
+    case RenderPass::VISIBILITY:  setup.pixelPipeline = getPixelPipeline(shader, instances[instance], opaque, DepthTest::ALWAYS); break;
+    default:                      setup.pixelPipeline = getPixelPipeline(shader, instances[instance], opaque, DepthTest::LESS);   break;
     }
 
-    // Start a clock to get the duration of triangle drawing.
-    clock_t triangleClock = clock();
+    // Keep the triangles of the visibility pass for the shading pass.
+    if (renderPass == RenderPass::VISIBILITY)
+    {
+        setup.id = visibilityNextId++;
+        visibilityTriangles.push_back(setup);
+        setup.pixelPipeline = &Renderer::visibilitySpan;
+    }
 
-    // Compute the triangle's bounding box.
-    int minX = min(screenCoords[0].x, min(screenCoords[1].x, screenCoords[2].x));
-    int minY = min(screenCoords[0].y, min(screenCoords[1].y, screenCoords[2].y));
-    int maxX = max(screenCoords[0].x, max(screenCoords[1].x, screenCoords[2].x));
-    int maxY = max(screenCoords[0].y, max(screenCoords[1].y, screenCoords[2].y));
+    // The tiled backend rasterizes the triangle when the frame is flushed.
+    if (rasterBackend == RasterBackend::TILED)
+    {
+        binTriangle(setup);
+    }
+    else
+    {
+        rasterizeTriangle(setup, setup.minX, setup.minY, setup.maxX, setup.maxY, stats);
+    }
+}
+
+bool Renderer::setupEdges(const Vector3* _screenCoords, TriangleSetup& _setup)
+{
+    // Snap the screen coordinates to fixed-point.
+    int fx[3], fy[3];
+    for (int i = 0; i < 3; i++)
+    {
+        fx[i] = toFixedPoint(_screenCoords[i].x);
+        fy[i] = toFixedPoint(_screenCoords[i].y);
+    }
+
+    // Degenerate triangles don't cover any pixel.
+    int64_t area = edgeFunction(fx[0], fy[0], fx[1], fy[1], fx[2], fy[2]);
+    if (area <= 0)
+    {
+        stats.zeroAreaCulled++;
+        return false;
+    }
+    _setup.invArea = 1.f / (float)area;
+
+    // Compute the bounding box of the pixels whose center can be inside the triangle.
+    const int half = SUBPIXEL_SCALE / 2;
+    _setup.minX = (min(fx[0], min(fx[1], fx[2])) - half + SUBPIXEL_SCALE - 1) >> SUBPIXEL_BITS;
+    _setup.minY = (min(fy[0], min(fy[1], fy[2])) - half + SUBPIXEL_SCALE - 1) >> SUBPIXEL_BITS;
+    _setup.maxX = (max(fx[0], max(fx[1], fx[2])) - half) >> SUBPIXEL_BITS;
+    _setup.maxY = (max(fy[0], max(fy[1], fy[2])) - half) >> SUBPIXEL_BITS;
+    if (_setup.minX > _setup.maxX || _setup.minY > _setup.maxY)
+    {
+        stats.zeroAreaCulled++;
+        return false;
+    }
 
     // Clip against screen bounds.
-    minX = clamp(minX, 0, (int)viewport.width  - 1); minY = clamp(minY, 0, (int)viewport.height - 1);
-    maxX = clamp(maxX, 0, (int)viewport.width  - 1); maxY = clamp(maxY, 0, (int)viewport.height - 1);
+    _setup.minX = max(_setup.minX, 0); _setup.maxX = min(_setup.maxX, (int)viewport.width  - 1);
+    _setup.minY = max(_setup.minY, 0); _setup.maxY = min(_setup.maxY, (int)viewport.height - 1);
+    if (_setup.minX > _setup.maxX || _setup.minY > _setup.maxY)
+    {
+        stats.frustumCulled++;
+        return false;
+    }
     
-    // Triangle setup.
-    int A01 = screenCoords[0].y - screenCoords[1].y, B01 = screenCoords[1].x - screenCoords[0].x;
-    int A12 = screenCoords[1].y - screenCoords[2].y, B12 = screenCoords[2].x - screenCoords[1].x;
-    int A20 = screenCoords[2].y - screenCoords[0].y, B20 = screenCoords[0].x - screenCoords[2].x;
-
-    // Determine barycentric coordinates.
-    Vector3 p = { (float)minX, (float)minY, 0 };
-    int w0_row = barycentricCoords(screenCoords[1], screenCoords[2], p);
-    int w1_row = barycentricCoords(screenCoords[2], screenCoords[0], p);
-    int w2_row = barycentricCoords(screenCoords[0], screenCoords[1], p);
-
-    // Loop p over the bounding box's pixel rows.
-    for (p.y = minY; p.y <= maxY; p.y++) 
-    {
-        // Set the barycentric coordinates at the start of each pixel row.
-        int w0 = w0_row;
-        int w1 = w1_row;
-        int w2 = w2_row;
-
-        // Loop p over the pixels of each row.
-        for (p.x = minX; p.x <= maxX; p.x++) 
+    // Triangle setup: edge function steps for one pixel.
+    _setup.A01 = (fy[0] - fy[1]) * SUBPIXEL_SCALE; _setup.B01 = (fx[1] - fx[0]) * SUBPIXEL_SCALE;
+    _setup.A12 = (fy[1] - fy[2]) * SUBPIXEL_SCALE; _setup.B12 = (fx[2] - fx[1]) * SUBPIXEL_SCALE;
+    _setup.A20 = (fy[2] - fy[0]) * SUBPIXEL_SCALE; _setup.B20 = (fx[0] - fx[2]) * SUBPIXEL_SCALE;
+
+    // Evaluate the edge functions at the center of the bounding box's origin pixel.
+    int64_t px = ((int64_t)_setup.minX << SUBPIXEL_BITS) + half;
+    int64_t py = ((int64_t)_setup.minY << SUBPIXEL_BITS) + half;
+    _setup.bias0    = fillRuleBias(_setup.A12, _setup.B12);
+    _setup.bias1    = fillRuleBias(_setup.A20, _setup.B20);
+    _setup.bias2    = fillRuleBias(_setup.A01, _setup.B01);
+    _setup.w0Origin = edgeFunction(fx[1], fy[1], fx[2], fy[2], px, py) + _setup.bias0;
+    _setup.w1Origin = edgeFunction(fx[2], fy[2], fx[0], fy[0], px, py) + _setup.bias1;
+    _setup.w2Origin = edgeFunction(fx[0], fy[0], fx[1], fy[1], px, py) + _setup.bias2;
+
+    // The span kernels step 32-bit edge functions: check that they can't overflow anywhere in the
+    // bounding box, including the lanes of the last span past its right side.
+    int64_t spanX = (int64_t)(_setup.maxX - _setup.minX + SPAN_WIDTH);
+    int64_t spanY = (int64_t)(_setup.maxY - _setup.minY + 1);
+    int64_t maxEdge = 0;
+    const int64_t origins[3] = { _setup.w0Origin, _setup.w1Origin, _setup.w2Origin };
+    const int     stepsA [3] = { _setup.A12, _setup.A20, _setup.A01 };
+    const int     stepsB [3] = { _setup.B12, _setup.B20, _setup.B01 };
+    for (int i = 0; i < 3; i++)
+        maxEdge = max(maxEdge, std::abs(origins[i]) + std::abs((int64_t)stepsA[i]) * spanX + std::abs((int64_t)stepsB[i]) * spanY);
+    _setup.wideEdges = maxEdge > INT32_MAX;
+
+    // Small triangles: test their few pixel centers right away.
+    _setup.isSmall = _setup.maxX - _setup.minX < SMALL_TRIANGLE_SIZE && _setup.maxY - _setup.minY < SMALL_TRIANGLE_SIZE;
+    if (_setup.isSmall)
+    {
+        _setup.sampleMask = 0;
+        for (int y = 0; y <= _setup.maxY - _setup.minY; y++)
         {
-            // If p is on or inside all edges, render the pixel.
-            if ((w0 | w1 | w2) >= 0) 
+            for (int x = 0; x <= _setup.maxX - _setup.minX; x++)
             {
-                // Transform the barycentric coordinates to percentages.
-                float w0n = w0 / (float)(w0 + w1 + w2);
-                float w1n = w1 / (float)(w0 + w1 + w2);
-                float w2n = w2 / (float)(w0 + w1 + w2);
-
-                // Compute the pixel's depth.
-                float depth = abs(perspectiveUV[0].z * w0n + perspectiveUV[1].z * w1n + perspectiveUV[2].z * w2n);
-                      depth = 1 / depth;
-                
-                // Interpolate pixel lighting.
-                Color pLight = WHITE;
-                if (renderMode == RenderMode::LIT)
-                {
-                    if (lightingMode == LightingMode::PHONG)
-                    {
-                        pLight =
-                        { 
-                            w0n * lightIntensity[0].r + w1n * lightIntensity[1].r + w2n * lightIntensity[2].r,
-                            w0n * lightIntensity[0].g + w1n * lightIntensity[1].g + w2n * lightIntensity[2].g,
-                            w0n * lightIntensity[0].b + w1n * lightIntensity[1].b + w2n * lightIntensity[2].b,
-                        };
-                    }
-                    else if (lightingMode == LightingMode::BLINN)
-                    {
-                        // Start a clock.
-                        clock_t lightingClock = clock();
-
-                        // Compute blinn lighting.
-                        Vector3 pixelPos = (worldCoords[0] * w0n + worldCoords[1] * w1n + worldCoords[2] * w2n).toVector3();
-                        pLight           = computePhong(*lights, material, pixelPos, worldNormal, cameraPos);
-                        
-                        // End the clock.
-                        lightingClock = clock() - lightingClock;
-
-                        // Update the lighting duration and counter.
-                        lightingDuration = (lightingDuration + lightingClock) / 2;
-                        lightingCounter++;
-                    }
-                }
+                int64_t w0 = _setup.w0Origin + (int64_t)x * _setup.A12 + (int64_t)y * _setup.B12;
+                int64_t w1 = _setup.w1Origin + (int64_t)x * _setup.A20 + (int64_t)y * _setup.B20;
+                int64_t w2 = _setup.w2Origin + (int64_t)x * _setup.A01 + (int64_t)y * _setup.B01;
+                if ((w0 | w1 | w2) >= 0)
+                    _setup.sampleMask |= 1 << (y * SMALL_TRIANGLE_SIZE + x);
+            }
+        }
 
-                // Define the pixel color.
-                Color pCol { 0, 0, 0, 1 };
+        // The triangle falls between pixel centers.
+        if (_setup.sampleMask == 0)
+        {
+            stats.zeroAreaCulled++;
+            return false;
+        }
+    }
 
-                // Interpolate between vertex colors using barycentric coordinates.
-                pCol.r = _triangle.a.color.r * w0n + _triangle.b.color.r * w1n + _triangle.c.color.r * w2n; 
-                pCol.g = _triangle.a.color.g * w0n + _triangle.b.color.g * w1n + _triangle.c.color.g * w2n; 
-                pCol.b = _triangle.a.color.b * w0n + _triangle.b.color.b * w1n + _triangle.c.color.b * w2n; 
-                pCol.a = _triangle.a.color.a * w0n + _triangle.b.color.a * w1n + _triangle.c.color.a * w2n;
+    return true;
+}
 
-                // Get the texture's color.
-                if (texture.pixels != nullptr)
-                {
-                    // Compute the uv coordinates.
-                    Vector2 uv = { clamp(depth * (perspectiveUV[0].x * w0n + perspectiveUV[1].x * w1n + perspectiveUV[2].x * w2n), 0, 1),
-                                   clamp(depth * (perspectiveUV[0].y * w0n + perspectiveUV[1].y * w1n + perspectiveUV[2].y * w2n), 0, 1) };
+uint32_t Renderer::getInstance(const Vector3& _cameraPos)
+{
+    // Start a new instance if the render state changed since the last one.
+    if (instanceDirty)
+    {
+        instances.push_back({ material, texture, vertexHueOnTextures, _cameraPos });
+        instanceDirty = false;
+    }
+    return (uint32_t)instances.size() - 1;
+}
 
-                    // Get the pixel color from the current texture.
-                    Color texColor = texture.getPixelColor(floorInt(uv.x * abs(texture.width )), 
-                                                           floorInt(uv.y * abs(texture.height)),
-                                                           pCol.a);
+// ---- Pixel pipelines ---- //
 
-                    // Apply the pixel hue to the texture color.
-                    if (vertexHueOnTextures)
-                    {
-                        HSV pHSV = RGBtoHSV(texColor);
-                        pCol = HSVtoRGB({ pCol.getHue(), pHSV.s, pHSV.v }, pCol.a);
-                    }
-                    // Apply the texture color to the pixel color.
-                    else
-                    {
-                        pCol.r = texColor.r;
-                        pCol.g = texColor.g;
-                        pCol.b = texColor.b;
-                    }
-                }
+void Renderer::depthSpan(const TriangleSetup&, const DrawInstance&, const int& _index, int _mask, const SpanValues& _span, PipelineStats& _stats)
+{
+    // Depth pre-pass: only keep the closest depth.
+    _stats.fragmentsTested += __builtin_popcount(_mask);
+    for (; _mask != 0; _mask &= _mask - 1)
+    {
+        int i = __builtin_ctz(_mask);
+        if (framebuffer.depthLess(_index + i, _span.depth[i]))
+        {
+            framebuffer.writeDepth(_index + i, _span.depth[i]);
+            _stats.fragmentsPassed++;
+        }
+    }
+}
 
-                // Apply the pixel lighting to the pixel color.
-                pCol *= pLight;
+void Renderer::visibilitySpan(const TriangleSetup& _setup, const DrawInstance&, const int& _index, int _mask, const SpanValues& _span, PipelineStats& _stats)
+{
+    // Visibility pass: only keep the closest depth and triangle.
+    _stats.fragmentsTested += __builtin_popcount(_mask);
+    for (; _mask != 0; _mask &= _mask - 1)
+    {
+        int i = __builtin_ctz(_mask);
+        if (framebuffer.depthLess(_index + i, _span.depth[i]))
+        {
+            framebuffer.writeDepth(_index + i, _span.depth[i]);
+            visibilityBuffer[_index + i] = { _setup.id, _setup.instance };
+            _stats.fragmentsPassed++;
+        }
+    }
+}
 
-                // Draw the pixel.
-                drawPixel(p.x, p.y, depth, pCol);
-            }
+const ShaderProgram& Renderer::getActiveShader() const
+{
+    if (shader != nullptr) return *shader;
+
+    // Built-in shader of the render and lighting modes.
+    switch (renderMode)
+    {
+    case RenderMode::LIT:     return lightingMode == LightingMode::BLINN ? getShaderProgram<BlinnShader>() : getShaderProgram<PhongShader>();
+    case RenderMode::ZBUFFER: return getShaderProgram<DepthShader>();
+    default:                  return getShaderProgram<UnlitShader>();
+    }
+}
+
+PixelPipeline Renderer::getPixelPipeline(const ShaderProgram& _shader, const DrawInstance& _instance, const bool& _opaque, const DepthTest& _test) const
+{
+    bool textured = _instance.texture.pixels != nullptr;
+    bool hue      = textured && _instance.vertexHueOnTextures;
+    return _shader.pixelPipelines[(int)framebuffer.getColorFormat() * 24 + textured * 12 + hue * 6 + !_opaque * 3 + (int)_test];
+}
+
+int Renderer::evaluateSpan(const TriangleSetup& _setup, const int64_t& _w0, const int64_t& _w1, const int64_t& _w2, const int& _count, SpanValues& _span) const
+{
+    if (_setup.wideEdges)
+        return spanScalarWide(_setup, _w0, _w1, _w2, _count, _span);
+    return spanKernel(_setup, (int)_w0, (int)_w1, (int)_w2, _count, _span);
+}
+
+void Renderer::interpolateSpan(const TriangleSetup& _setup, const int64_t& _w0, const int64_t& _w1, const int64_t& _w2, const int& _count, SpanValues& _span) const
+{
+    if (_setup.wideEdges)
+        interpolateScalarWide(_setup, _w0, _w1, _w2, _count, _span);
+    else
+        spanInterpolator(_setup, (int)_w0, (int)_w1, (int)_w2, _count, _span);
+}
+
+// Smallest and largest values of an edge function over the pixel centers of a block.
+static int64_t edgeMin(const int64_t& _w, const int& _A, const int& _B, const int& _cols, const int& _rows)
+{
+    return _w + (int64_t)min(_A, 0) * (_cols - 1) + (int64_t)min(_B, 0) * (_rows - 1);
+}
+static int64_t edgeMax(const int64_t& _w, const int& _A, const int& _B, const int& _cols, const int& _rows)
+{
+    return _w + (int64_t)max(_A, 0) * (_cols - 1) + (int64_t)max(_B, 0) * (_rows - 1);
+}
+
+// Spans start on the block grid and must not cross a framebuffer tile.
+static_assert(FRAMEBUFFER_TILE_SIZE % BLOCK_SIZE == 0, "Framebuffer tiles must hold whole blocks.");
 
-            // Move one pixel to the right.
-            w0 += A12;
-            w1 += A20;
-            w2 += A01;
+// Framebuffer tiles are cleared by the thread that first draws to them: they must not be shared between bins.
+static_assert(TILE_SIZE % FRAMEBUFFER_TILE_SIZE == 0, "Bins must hold whole framebuffer tiles.");
+
+void Renderer::rasterizeTriangle(const TriangleSetup& _setup, int _minX, int _minY, int _maxX, int _maxY, PipelineStats& _stats)
+{
+    const DrawInstance& instance = instances[_setup.instance];
+
+    // Restrict the given area to the triangle's bounding box.
+    _minX = max(_minX, _setup.minX); _minY = max(_minY, _setup.minY);
+    _maxX = min(_maxX, _setup.maxX); _maxY = min(_maxY, _setup.maxY);
+    if (_minX > _maxX || _minY > _maxY) return;
+
+    if (_setup.isSmall)
+    {
+        rasterizeSmallTriangle(_setup, instance, _minX, _minY, _maxX, _maxY, _stats);
+        return;
+    }
+
+    // Loop over the area's rows of blocks. Blocks are aligned to the framebuffer's tiles, so that their spans are contiguous in memory.
+    SpanValues span;
+    for (int blockY = _minY - _minY % BLOCK_SIZE; blockY <= _maxY; blockY += BLOCK_SIZE) 
+    {
+        const int startY = max(blockY, _minY);
+        const int rows   = min(blockY + BLOCK_SIZE, _maxY + 1) - startY;
+
+        for (int blockX = _minX - _minX % BLOCK_SIZE; blockX <= _maxX; blockX += BLOCK_SIZE) 
+        {
+            const int startX = max(blockX, _minX);
+            const int cols   = min(blockX + BLOCK_SIZE, _maxX + 1) - startX;
+
+            // Step the barycentric coordinates from the bounding box's origin to the block's first pixel.
+            int64_t w0 = _setup.w0Origin + (int64_t)(startX - _setup.minX) * _setup.A12 + (int64_t)(startY - _setup.minY) * _setup.B12;
+            int64_t w1 = _setup.w1Origin + (int64_t)(startX - _setup.minX) * _setup.A20 + (int64_t)(startY - _setup.minY) * _setup.B20;
+            int64_t w2 = _setup.w2Origin + (int64_t)(startX - _setup.minX) * _setup.A01 + (int64_t)(startY - _setup.minY) * _setup.B01;
+
+            // Skip the block if all of its pixels are outside of one of the edges.
+            if (edgeMax(w0, _setup.A12, _setup.B12, cols, rows) < 0 ||
+                edgeMax(w1, _setup.A20, _setup.B20, cols, rows) < 0 ||
+                edgeMax(w2, _setup.A01, _setup.B01, cols, rows) < 0)
+            {
+                _stats.skippedBlocks++;
+            }
+            else
+            {
+                // Blocks that are inside all edges don't need a coverage test.
+                bool covered = edgeMin(w0, _setup.A12, _setup.B12, cols, rows) >= 0 &&
+                               edgeMin(w1, _setup.A20, _setup.B20, cols, rows) >= 0 &&
+                               edgeMin(w2, _setup.A01, _setup.B01, cols, rows) >= 0;
+                if (covered) _stats.coveredBlocks++;
+                else         _stats.partialBlocks++;
+
+                // Clear the block's framebuffer tile if it is the first one to be drawn in it.
+                framebuffer.prepareTile(startX, startY);
+
+                // Loop over the block's rows: each of them is a span.
+                int64_t w0_span = w0, w1_span = w1, w2_span = w2;
+                for (int y = startY; y < startY + rows; y++)
+                {
+                    // Evaluate the barycentric coordinates, depth and uvs of the whole span at once
+                    // (covered blocks skip the coverage test).
+                    int mask = (1 << cols) - 1;
+                    if (covered) interpolateSpan(_setup, w0_span, w1_span, w2_span, cols, span);
+                    else         mask = evaluateSpan(_setup, w0_span, w1_span, w2_span, cols, span);
+                    (this->*_setup.pixelPipeline)(_setup, instance, framebuffer.getIndex(startX, y), mask, span, _stats);
+
+                    // Move down by one pixel row.
+                    w0_span += _setup.B12;
+                    w1_span += _setup.B20;
+                    w2_span += _setup.B01;
+                }
+            }
         }
+    }
+}
 
-        // Move down by one pixel row.
-        w0_row += B12;
-        w1_row += B20;
-        w2_row += B01;
+void Renderer::rasterizeSmallTriangle(const TriangleSetup& _setup, const DrawInstance& _instance, int _minX, int _minY, int _maxX, int _maxY, PipelineStats& _stats)
+{
+    // The coverage of the few pixels was computed during setup: only interpolate the covered rows.
+    // Rows that cross a block boundary are split in two spans, to keep each span contiguous in memory.
+    SpanValues span;
+    for (int y = _minY; y <= _maxY; y++)
+    {
+        for (int startX = _minX, endX; startX <= _maxX; startX = endX)
+        {
+            endX = min(startX - startX % BLOCK_SIZE + BLOCK_SIZE, _maxX + 1);
+            const int cols = endX - startX;
+            int mask = (_setup.sampleMask >> ((y - _setup.minY) * SMALL_TRIANGLE_SIZE + startX - _setup.minX)) & ((1 << cols) - 1);
+            if (mask == 0) continue;
+
+            int64_t w0 = _setup.w0Origin + (int64_t)(startX - _setup.minX) * _setup.A12 + (int64_t)(y - _setup.minY) * _setup.B12;
+            int64_t w1 = _setup.w1Origin + (int64_t)(startX - _setup.minX) * _setup.A20 + (int64_t)(y - _setup.minY) * _setup.B20;
+            int64_t w2 = _setup.w2Origin + (int64_t)(startX - _setup.minX) * _setup.A01 + (int64_t)(y - _setup.minY) * _setup.B01;
+            evaluateSpan(_setup, w0, w1, w2, cols, span);
+            framebuffer.prepareTile(startX, y);
+            (this->*_setup.pixelPipeline)(_setup, _instance, framebuffer.getIndex(startX, y), mask, span, _stats);
+        }
     }
+}
 
-    // End the triangle drawing clock here.
-    triangleClock = clock() - triangleClock;
+void Renderer::binTriangle(const TriangleSetup& _setup)
+{
+    // Store the triangle and add its index to every tile its bounding box overlaps.
+    uint32_t index = (uint32_t)binnedTriangles.size();
+    binnedTriangles.push_back(_setup);
 
-    // Update the triangle duration value.
-    triangleDuration = (triangleDuration + triangleClock) / 2;
+    for (int ty = _setup.minY / TILE_SIZE; ty <= _setup.maxY / TILE_SIZE; ty++)
+        for (int tx = _setup.minX / TILE_SIZE; tx <= _setup.maxX / TILE_SIZE; tx++)
+            tileBins[ty * tilesX + tx].push_back(index);
+}
+
+void Renderer::rasterizeBins()
+{
+    if (binnedTriangles.empty()) return;
+
+    // Each worker owns the tiles it takes, so they can write to the framebuffer without locks.
+    vector<PipelineStats> workerStats(threadPool.getThreadCount());
+    threadPool.parallelFor(tilesX * tilesY, [&](int _tile, int _worker)
+    {
+        if (tileBins[_tile].empty()) return;
+        PROFILE_NAMED_SCOPE(tileScope, ProfileZone::TILE);
+        PROFILE_SET_ARG(tileScope, 0, _tile);
+        PROFILE_SET_ARG(tileScope, 1, (int)tileBins[_tile].size());
+
+        int minX = (_tile % tilesX) * TILE_SIZE, maxX = min(minX + TILE_SIZE, (int)viewport.width ) - 1;
+        int minY = (_tile / tilesX) * TILE_SIZE, maxY = min(minY + TILE_SIZE, (int)viewport.height) - 1;
+
+        // Rasterize the tile's triangles in submission order to keep alpha blending identical.
+        for (uint32_t index : tileBins[_tile])
+            rasterizeTriangle(binnedTriangles[index], minX, minY, maxX, maxY, workerStats[_worker]);
+    });
+    mergeStats(workerStats);
+
+    // Empty the bins while keeping their memory for the next frame.
+    binnedTriangles.clear();
+    for (vector<uint32_t>& bin : tileBins)
+        bin.clear();
+}
+
+void Renderer::mergeStats(const vector<PipelineStats>& _workerStats)
+{
+    for (const PipelineStats& workerStats : _workerStats)
+        stats += workerStats;
+}
+
+void Renderer::flush()
+{
+    rasterizeBins();
+
+    // Forget this frame's triangles and draw instances.
+    visibilityTriangles.clear();
+    instances.clear();
+    instanceDirty = true;
+}
+
+void Renderer::resolveVisibility()
+{
+    PROFILE_SCOPE(ProfileZone::RESOLVE);
+
+    // Make sure the tiled backend has filled the visibility buffer.
+    rasterizeBins();
+
+    // Shade every visible pixel once, splitting the rows between the workers.
+    vector<PipelineStats> workerStats(threadPool.getThreadCount());
+    threadPool.parallelFor(viewport.height, [&](int _y, int _worker)
+    {
+        SpanValues span;
+        for (int x = 0; x < (int)viewport.width; )
+        {
+            const int               index  = framebuffer.getIndex(x, _y);
+            const VisibilitySample& sample = visibilityBuffer[index];
+            if (sample.triangle == EMPTY_VISIBILITY || sample.triangle < visibilityFirstId) { x++; continue; }
+
+            // Gather the run of pixels covered by the same triangle (without crossing a block boundary, to stay contiguous in memory).
+            int count = 1;
+            while ((x + count) % SPAN_WIDTH != 0 && x + count < (int)viewport.width && visibilityBuffer[index + count].triangle == sample.triangle)
+                count++;
+
+            // Rebuild the barycentric coordinates of the run and interpolate it at once.
+            const TriangleSetup& setup = visibilityTriangles[sample.triangle - visibilityFirstId];
+            int64_t w0   = setup.w0Origin + (int64_t)(x - setup.minX) * setup.A12 + (int64_t)(_y - setup.minY) * setup.B12;
+            int64_t w1   = setup.w1Origin + (int64_t)(x - setup.minX) * setup.A20 + (int64_t)(_y - setup.minY) * setup.B20;
+            int64_t w2   = setup.w2Origin + (int64_t)(x - setup.minX) * setup.A01 + (int64_t)(_y - setup.minY) * setup.B01;
+            int     mask = evaluateSpan(setup, w0, w1, w2, count, span);
+
+            // Shade the run's pixels (their framebuffer tile was cleared by the visibility pass).
+            (this->*setup.pixelPipeline)(setup, instances[sample.instance], index, mask, span, workerStats[_worker]);
+            x += count;
+        }
+    });
+    mergeStats(workerStats);
 }
 
 void Renderer::drawTriangles(Triangle3* _triangles, const unsigned int& _count)
@@ -461,22 +917,17 @@ void Renderer::drawDividedQuad(const Color& _color, const float& _size, const bo
     Vector3 normal = (Vector3(A, B) ^ Vector3(A, D)).getNormalized();
     if (_negateNormals) normal.negate();
 
-    // Create the 2 triangles that form the quad.
-    Triangle3 triangles[2] = 
+    // Create the 2 triangles that form the quad, sharing the A and C vertices.
+    Vertex vertices[4] = 
     {
-        {
-            { A, normal, _color, { 1, 0 } },
-            { B, normal, _color, { 0, 0 } },
-            { C, normal, _color, { 0, 1 } },
-        },
-        {
-            { A, normal, _color, { 1, 0 } },
-            { D, normal, _color, { 1, 1 } },
-            { C, normal, _color, { 0, 1 } },
-        },
+        { A, normal, _color, { 1, 0 } },
+        { B, normal, _color, { 0, 0 } },
+        { C, normal, _color, { 0, 1 } },
+        { D, normal, _color, { 1, 1 } },
     };
+    uint32_t indices[6] = { 0, 1, 2, 0, 3, 2 };
     
-    drawTriangles(triangles, 2);
+    drawIndexed(vertices, 4, indices, 6);
 }
 
 void Renderer::drawCube(const Color& _color, const float& _size)
@@ -581,59 +1032,124 @@ void Renderer::drawDividedCube(const Color& _color, const float& _size, const fl
 
 void Renderer::drawSphere(const Color& _color, const float& _r, const int& _lon, const int& _lat)
 {
-    for (int j = 0; j < _lat; j++)
+    // Create the sphere's vertices, ring by ring (the first and last vertex of each ring are at the same position, with different uvs).
+    vector<Vertex> vertices;
+    vertices.reserve((_lat + 1) * (_lon + 1));
+    for (int j = 0; j <= _lat; j++)
     {
-        float theta0 = ( (j + 0) / (float)_lat) * PI;
-        float theta1 = ( (j + 1) / (float)_lat) * PI;
+        float theta = (j / (float)_lat) * PI;
 
+        for (int i = 0; i <= _lon; i++)
+        {
+            float   phi = (i / (float)_lon) * 2.f * PI;
+            Vector3 pos = getSphericalCoords(_r, theta, phi);
+            vertices.push_back({ pos, pos.getNormalized(), _color, { i / (float)_lon, 1 - j / (float)_lat } });
+        }
+    }
+
+    // Create the triangles of each face between two rings, except the ones that are degenerate at the poles.
+    vector<uint32_t> indices;
+    indices.reserve(_lat * _lon * 6);
+    for (int j = 0; j < _lat; j++)
+    {
         for (int i = 0; i < _lon; i++)
         {
-            float phi0 = ( (i + 0) / (float)_lon) * 2.f * PI;
-            float phi1 = ( (i + 1) / (float)_lon) * 2.f * PI;
-
-            // Get the position of the 4 points of the current face.
-            Vector3 c0 = getSphericalCoords(_r, theta0, phi0);
-            Vector3 c1 = getSphericalCoords(_r, theta0, phi1);
-            Vector3 c2 = getSphericalCoords(_r, theta1, phi1);
-            Vector3 c3 = getSphericalCoords(_r, theta1, phi0);
-
-            // Compute the face normal.
-            Vector3 normal = (Vector3(c0, c1) ^ Vector3(c0, c2));
-            if (normal.x == 0 && normal.y == 0 && normal.z == 0)
-                normal = (Vector3(c0, c2) ^ Vector3(c0, c3));
-            normal.normalize();
-
-            // Create the face triangles.
-            Triangle3 triangles[2] = 
-            {
-                {
-                    { c0, normal, _color, { 0, 1 } },
-                    { c1, normal, _color, { 1, 1 } },
-                    { c2, normal, _color, { 1, 0 } },
-                },
-                {
-                    { c0, normal, _color, { 0, 1 } },
-                    { c2, normal, _color, { 1, 0 } },
-                    { c3, normal, _color, { 0, 0 } },
-                }
-            };
-    
-            drawTriangles(triangles, 2);
+            // Get the indices of the 4 points of the current face.
+            uint32_t c0 = j * (_lon + 1) + i, c1 = c0 + 1;
+            uint32_t c3 = c0 + _lon + 1,      c2 = c3 + 1;
+
+            if (j > 0)        indices.insert(indices.end(), { c0, c1, c2 });
+            if (j < _lat - 1) indices.insert(indices.end(), { c0, c2, c3 });
         }
     }
+
+    drawIndexed(vertices.data(), (unsigned int)vertices.size(), indices.data(), (unsigned int)indices.size());
 }
 
 // --- Material and texture setters --- //
 
-void     Renderer::setTexture (const TextureData& _textureData)     { texture  = _textureData;        }
+void     Renderer::setTexture (const TextureData& _textureData)     { texture  = _textureData;        instanceDirty = true; }
 Material Renderer::getMaterial() const                              { return material;                }
-void     Renderer::setMaterial(const Material& _material)           { material = _material;           }
-void     Renderer::applyVertexColorToTextures(const bool& _boolean) { vertexHueOnTextures = _boolean; }
+void     Renderer::setMaterial(const Material& _material)           { material = _material;           instanceDirty = true; }
+void     Renderer::applyVertexColorToTextures(const bool& _boolean) { vertexHueOnTextures = _boolean; instanceDirty = true; }
 void     Renderer::doBackfaceCulling(const bool& _boolean)          { cullBackFaces = _boolean;       }
-void     Renderer::resetCounters()                                  { triangleCounter = 0; lightingCounter = 0; transformCounter = 0; }
+void     Renderer::setRasterBackend(const RasterBackend& _backend)  { flush(); rasterBackend = _backend; }
+void     Renderer::setRasterKernel (const RasterKernel& _kernel)    { flush(); rasterKernel = _kernel; spanKernel = getSpanKernel(_kernel); spanInterpolator = getSpanInterpolator(_kernel); }
+void     Renderer::setRenderMode   (const RenderMode& _mode)        { renderMode   = _mode; }
+void     Renderer::setLightingMode (const LightingMode& _mode)      { lightingMode = _mode; }
+void     Renderer::setGuardBand    (const float& _guardBand)        { guardBand = clamp(_guardBand, 1, MAX_GUARD_BAND); }
+float    Renderer::getGuardBand    () const                         { return guardBand; }
+
+// The viewport spans [-w/2, w/2] on x and y in clip space.
+float    Renderer::getClipExtent   () const                         { return guardBand / 2; }
+
+// ------- Multi-pass pipelines ------- //
+
+void           Renderer::setRenderPipeline(const RenderPipeline& _pipeline) { renderPipeline = _pipeline; }
+RenderPipeline Renderer::getRenderPipeline() const                          { return renderPipeline;    }
+
+RenderPipeline Renderer::getActivePipeline() const
+{
+    // Wireframes are always drawn forward.
+    return renderMode == RenderMode::WIREFRAME ? RenderPipeline::FORWARD : renderPipeline;
+}
+
+void Renderer::setRenderPass(const RenderPass& _pass)
+{
+    renderPass = _pass;
+
+    // Start the visibility buffer over: the samples of the last frames become empty once the ids move past them.
+    // It is only filled when it is resized, or before the ids can run into EMPTY_VISIBILITY.
+    if (renderPass == RenderPass::VISIBILITY)
+    {
+        visibilityTriangles.clear();
+        if ((int)visibilityBuffer.size() != framebuffer.getBufferSize() || visibilityNextId >= EMPTY_VISIBILITY / 2)
+        {
+            visibilityBuffer.assign(framebuffer.getBufferSize(), { EMPTY_VISIBILITY, 0 });
+            visibilityNextId = 0;
+        }
+        visibilityFirstId = visibilityNextId;
+    }
+}
+
+// ------- Pipeline statistics ------- //
+
+void Renderer::resetCounters()
+{
+    // Write the statistics of the frame that just ended.
+    if (statsPending) statsCSV.writeFrame(stats);
+    statsPending = statsCSV.isOpen();
+
+    stats = PipelineStats();
+    stats.pixels = viewport.width * viewport.height;
+}
+
+const PipelineStats& Renderer::getPipelineStats() const { return stats; }
+
+bool Renderer::startStatsCSV(const string& _path)
+{
+    // The first frame written is the next one.
+    statsPending = false;
+    return statsCSV.open(_path);
+}
+
+void Renderer::stopStatsCSV()
+{
+    // Write the last frame.
+    if (statsPending) statsCSV.writeFrame(stats);
+    statsPending = false;
+    statsCSV.close();
+}
+
+bool Renderer::isWritingStats() const { return statsCSV.isOpen(); }
+
+// ------------- Shaders ------------- //
+
+void Renderer::resetShader() { shader = nullptr; }
 
 // ---------- Miscellaneous ---------- //
 
+#ifndef HEADLESS
 void Renderer::showImGuiControls()
 {
     // Render mode static.
@@ -643,6 +1159,30 @@ void Renderer::showImGuiControls()
     // Lighting mode static.
     static const char* lModeItems[]{ "Phong", "Blinn" };
     static int lModeCur = 0;
+
+    // Raster backend static.
+    static const char* bModeItems[]{ "Immediate", "Tiled" };
+    static int bModeCur = 0;
+
+    // Render pipeline static.
+    static const char* pModeItems[]{ "Forward", "Depth pre-pass", "Visibility buffer" };
+    static int pModeCur = 0;
+
+    // Raster kernel static.
+    static const char* kModeItems[]{ "Scalar", "SSE", "AVX2" };
+    static int kModeCur = (int)getBestRasterKernel();
+
+    // Color format static.
+    static const char* fModeItems[]{ "RGBA8", "sRGB8 A8", "RGBA32F (HDR)" };
+    static int fModeCur = (int)framebuffer.getColorFormat();
+
+    // Depth format static.
+    static const char* dModeItems[]{ "Float", "Float (reversed)", "16-bit", "24-bit" };
+    static int dModeCur = (int)framebuffer.getDepthFormat();
+
+    // Framebuffer layout static.
+    static const char* mModeItems[]{ "Linear", "Tiled 8x8" };
+    static int mModeCur = (int)framebuffer.getLayout();
     
     // Compute items padding.
     ImVec2 p0 = ImGui::GetCursorScreenPos();
@@ -652,20 +1192,61 @@ void Renderer::showImGuiControls()
     // Displaying components.
     ImGui::ColorEdit4("BG Color", &framebuffer.clearColor.r);
 
+    ImGui::Combo("Color Format", &fModeCur, fModeItems, IM_ARRAYSIZE(fModeItems));
+    framebuffer.setColorFormat((ColorFormat)fModeCur);
+
+    ImGui::Combo("Depth Format", &dModeCur, dModeItems, IM_ARRAYSIZE(dModeItems));
+    framebuffer.setDepthFormat((DepthFormat)dModeCur);
+
+    ImGui::Combo("Memory Layout", &mModeCur, mModeItems, IM_ARRAYSIZE(mModeItems));
+    framebuffer.setLayout((FramebufferLayout)mModeCur);
+
     ImGui::Combo("Render Mode", &rModeCur, rModeItems, IM_ARRAYSIZE(rModeItems));
     renderMode = (RenderMode)rModeCur;
 
     ImGui::Combo("Lighting Mode", &lModeCur, lModeItems, IM_ARRAYSIZE(lModeItems));
     lightingMode = (LightingMode)lModeCur;
 
+    ImGui::Combo("Pipeline", &pModeCur, pModeItems, IM_ARRAYSIZE(pModeItems));
+    renderPipeline = (RenderPipeline)pModeCur;
+
+    ImGui::Combo("Raster Backend", &bModeCur, bModeItems, IM_ARRAYSIZE(bModeItems));
+    if (rasterBackend != (RasterBackend)bModeCur) setRasterBackend((RasterBackend)bModeCur);
+    if (rasterBackend == RasterBackend::TILED)
+        ImGui::Text("Worker threads: %d", threadPool.getThreadCount());
+
+    ImGui::Combo("Raster Kernel", &kModeCur, kModeItems, IM_ARRAYSIZE(kModeItems));
+    if (!isRasterKernelSupported((RasterKernel)kModeCur)) kModeCur = (int)getBestRasterKernel();
+    if (rasterKernel != (RasterKernel)kModeCur) setRasterKernel((RasterKernel)kModeCur);
+
+    if (ImGui::SliderFloat("Guard Band", &guardBand, 1, MAX_GUARD_BAND, "%.1fx"))
+        setGuardBand(guardBand);
+
     ImGui::EndGroup();
 
     // Display durations.
     ImGui::Begin("Rendering clocks");
     {
-        ImGui::Text("Triangles: %d X %.fus", triangleCounter, (float)triangleDuration * 1000000 / CLOCKS_PER_SEC);
-        ImGui::Text("Lighting : %d X %.fus", lightingCounter, (float)lightingDuration * 1000000 / CLOCKS_PER_SEC);
-        ImGui::Text("Vertex transforms: %d X %.fus", transformCounter, (float)transformDuration * 1000000 / CLOCKS_PER_SEC);
+        ImGui::Text("Vertex transforms: %d", stats.verticesTransformed);
+        ImGui::Text("Lighting: %d", stats.lightingComputations);
+        ImGui::Text("Triangles: %d submitted, %d rasterized (%d small)", stats.trianglesSubmitted, stats.trianglesRasterized, stats.smallTriangles);
+        ImGui::Text("Culled triangles: %d backface, %d clip, %d frustum, %d zero-area", stats.backfaceCulled, stats.clipCulled, stats.frustumCulled, stats.zeroAreaCulled);
+        ImGui::Text("Clipped triangles: %d", stats.clippedTriangles);
+        ImGui::Text("Blocks: %d skipped, %d partial, %d covered", stats.skippedBlocks, stats.partialBlocks, stats.coveredBlocks);
+        ImGui::Text("Fragments: %d tested, %d passed, %d killed early", stats.fragmentsTested, stats.fragmentsPassed, stats.earlyDepthKills);
+        ImGui::Text("Fragments: %d shaded, %d blended (%.2fx overdraw)", stats.fragmentsShaded, stats.fragmentsBlended, stats.getOverdraw());
+        ImGui::Text("Texture samples: %d", stats.textureSamples);
+
+        // Write the statistics of each frame to a CSV file while the box is checked.
+        bool writeStats = isWritingStats();
+        if (ImGui::Checkbox("Write stats.csv", &writeStats))
+        {
+            if (writeStats) startStatsCSV("stats.csv");
+            else            stopStatsCSV();
+        }
+        ImGui::Separator();
+        profiler::showImGuiControls();
     }
     ImGui::End();
 }
+#endif
@@ -1,6 +1,8 @@
 #include <string>
 
+#ifndef HEADLESS
 #include <imgui.h>
+#endif
 #include <my_math.hpp>
 
 #include <Light.hpp>
@@ -11,7 +13,7 @@
 using namespace std;
 using namespace geometry3D;
 
-Scene::Scene()
+Scene::Scene(const ScenePreset& _preset)
 {
     // Setup default lights.
     lights.clear();
@@ -20,11 +22,43 @@ Scene::Scene()
     lights.push_back({ 5, 1, 0.2, 0.1, { -3, -1.5, 0 }, WHITE  });
     lights.push_back({ 5, 1, 0.2, 0.1, {  0,  0,   4 }, BLUE });
 
-    // Setup default shapes.
-    shapeManager.addShape({ ShapeTypes::CUBE,   1, { -0.5, 0, 2 }, { 0, 0, 0 }, { 1, 1, 0.2 } });
-    shapeManager.addShape({ ShapeTypes::SPHERE, 1, {  0.5, 0, 2 }, { 0, 0, 0 }, { 1, 1, 0.2 } });
-    shapeManager.getShape(0).color = { 1, 1, 1, 0.7 };
-    shapeManager.getShape(1).subdivisions = 20;
+    // Setup the preset's shapes.
+    switch (_preset)
+    {
+    case ScenePreset::SPHERE_WALL:
+        // 3x3 spheres, each of them made of 20000 triangles.
+        for (int i = 0; i < 9; i++)
+        {
+            shapeManager.addShape({ ShapeTypes::SPHERE, 0.3, { (i % 3 - 1) * 0.7f, (i / 3 - 1) * 0.7f, 2 }, { 0, 0, 0 }, { 1, 1, 0.2 } });
+            shapeManager.getShape(i).subdivisions = 100;
+        }
+        break;
+
+    case ScenePreset::TRANSLUCENT_STACKS:
+        // Alternating quads and cubes from back to front, covering most of the screen.
+        for (int i = 0; i < 8; i++)
+        {
+            shapeManager.addShape({ i % 2 == 0 ? ShapeTypes::QUAD : ShapeTypes::CUBE, 2 - i * 0.15f, { (i % 4 - 1.5f) * 0.3f, 0, 3.5f - i * 0.25f }, { 0, 0, 0 }, { 1, 1, 0.2 } });
+            shapeManager.getShape(i).color = { i % 3 == 0 ? 1.f : 0.3f, i % 3 == 1 ? 1.f : 0.3f, i % 3 == 2 ? 1.f : 0.3f, 0.4f };
+        }
+        break;
+
+    case ScenePreset::TEXTURED_CUBES:
+        // 2 rows of rotated cubes (all of them are untextured if no texture was loaded).
+        for (int i = 0; i < 8; i++)
+        {
+            shapeManager.addShape({ ShapeTypes::CUBE, 0.6, { (i % 4 - 1.5f) * 0.8f, (i / 4 - 0.5f) * 0.8f, 2.5 }, { 0.4f + i * 0.2f, 0.3f * i, 0 }, { 1, 1, 0.2 } });
+            shapeManager.getShape(i).textureID = (i + 1) % shapeManager.getTextureNum();
+        }
+        break;
+
+    default:
+        shapeManager.addShape({ ShapeTypes::CUBE,   1, { -0.5, 0, 2 }, { 0, 0, 0 }, { 1, 1, 0.2 } });
+        shapeManager.addShape({ ShapeTypes::SPHERE, 1, {  0.5, 0, 2 }, { 0, 0, 0 }, { 1, 1, 0.2 } });
+        shapeManager.getShape(0).color = { 1, 1, 1, 0.7 };
+        shapeManager.getShape(1).subdivisions = 20;
+        break;
+    }
 }
 
 void Scene::update(const float& _deltaTime, Renderer& _renderer, const Camera& _camera)
@@ -53,6 +87,7 @@ void Scene::update(const float& _deltaTime, Renderer& _renderer, const Camera& _
 
 vector<Light>* Scene::getLights() { return &lights; }
 
+#ifndef HEADLESS
 void Scene::showImGuiControls(Renderer& _renderer)
 {    
     // Light pannel.
@@ -111,3 +146,4 @@ void Scene::showImGuiControls(Renderer& _renderer)
     // Shapes pannel.
     shapeManager.showImGuiControls();
 }
+#endif
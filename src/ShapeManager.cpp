@@ -1,8 +1,13 @@
 #include <ShapeManager.hpp>
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
 #include <tinydir.h>
 
+#ifndef HEADLESS
+#include <imgui.h>
+#endif
+
 
 ShapeManager::ShapeManager()
 {
@@ -16,6 +21,7 @@ ShapeManager::ShapeManager()
     tinydir_open(&dir, "art");
 
     // Loop over all the files in the dirextory.
+    std::vector<std::string> fileNames;
     while (dir.has_next)
     {
         tinydir_file file;
@@ -23,12 +29,17 @@ ShapeManager::ShapeManager()
 
         // Get the file name.
         std::string fileName = file.name;
-        if (fileName == ".." || fileName == ".") 
-        {
-            tinydir_next(&dir);
-            continue;
-        }
+        if (fileName != ".." && fileName != ".") 
+            fileNames.push_back(fileName);
+
+        tinydir_next(&dir);
+    }
+    tinydir_close(&dir);
 
+    // Sort the files so that texture IDs don't depend on the file system.
+    std::sort(fileNames.begin(), fileNames.end());
+    for (std::string& fileName : fileNames)
+    {
         // Load the texture.
         texture = loadBmpData(("art/" + fileName).c_str());
         textures.push_back(texture);
@@ -36,10 +47,7 @@ ShapeManager::ShapeManager()
         // Remove the file extension and save the name.
         fileName = fileName.substr(0, fileName.length()-4);
         textureNames.push_back(fileName);
-
-        tinydir_next(&dir);
     }
-    tinydir_close(&dir);
 }
 
 ShapeManager::~ShapeManager()
@@ -77,64 +85,116 @@ int ShapeManager::getShapeNum()
     return (int)shapes.size();
 }
 
+int ShapeManager::getTextureNum()
+{
+    return (int)textures.size();
+}
+
 void ShapeManager::delShape(const int& _index)
 {
     if (0 <= _index && _index < getShapeNum())
         shapes.erase(shapes.begin() + _index);
 }
 
+static bool isShapeOpaque(const Shape& _shape)
+{
+    if (_shape.type == ShapeTypes::TRIANGLE)
+        return _shape.triangleData.a.color.a > 0.99 && _shape.triangleData.b.color.a > 0.99 && _shape.triangleData.c.color.a > 0.99;
+    return _shape.color.a > 0.99;
+}
+
 void ShapeManager::drawShapes(Renderer& _renderer)
 {
-    for (Shape shape : shapes)
+    switch (_renderer.getActivePipeline())
     {
-        // If the shpe's alpha is 0, don't draw it.
-        if (shape.color.a <= 0.01)
-            continue;
-
-        // Tell the renderer to use the shape's material and texture.
-        _renderer.setMaterial(shape.material);
-        _renderer.setTexture(textures[shape.textureID]);
-        _renderer.applyVertexColorToTextures(shape.applyVertexColor);
-
-        // Disable backface culling for triangles and quads.
-        if (shape.type == ShapeTypes::TRIANGLE || shape.type == ShapeTypes::QUAD)
-            _renderer.doBackfaceCulling(false);
-        else
-            _renderer.doBackfaceCulling(true);
-
-        // Translate the shape to its world position.
-        _renderer.modelPushMat();
-        _renderer.modelTranslate(shape.pos.x, shape.pos.y, shape.pos.z);
-        _renderer.modelRotateX(shape.rot.x);
-        _renderer.modelRotateY(shape.rot.y);
-        _renderer.modelRotateZ(shape.rot.z);
-
-        // Draw the shape.
-        switch (shape.type)
-        {
-        case ShapeTypes::TRIANGLE:
-            _renderer.drawTriangle(shape.triangleData);
-            break;
-        case ShapeTypes::QUAD:
-            _renderer.drawDividedQuad(shape.color, shape.size);
-            break;
-        case ShapeTypes::CUBE:
-            _renderer.drawCube(shape.color, shape.size);
-            break;
-        case ShapeTypes::DIVIDED_CUBE:
-            _renderer.drawDividedCube(shape.color, shape.size, shape.subdivisions);
-            break;
-        case ShapeTypes::SPHERE:
-            _renderer.drawSphere(shape.color, shape.size, shape.subdivisions, shape.subdivisions);
-            break;
-        default: 
-            break;
-        }
+    case RenderPipeline::DEPTH_PREPASS:
+        // Lay down the depth of the opaque shapes.
+        _renderer.setRenderPass(RenderPass::DEPTH_ONLY);
+        for (const Shape& shape : shapes)
+            if (isShapeOpaque(shape)) drawShape(_renderer, shape);
+
+        // Shade the opaque shapes only where they are the closest.
+        _renderer.setRenderPass(RenderPass::DEPTH_EQUAL);
+        for (const Shape& shape : shapes)
+            if (isShapeOpaque(shape)) drawShape(_renderer, shape);
+        break;
+
+    case RenderPipeline::VISIBILITY_BUFFER:
+        // Store the closest triangle of each pixel, then shade every visible pixel once.
+        _renderer.setRenderPass(RenderPass::VISIBILITY);
+        for (const Shape& shape : shapes)
+            if (isShapeOpaque(shape)) drawShape(_renderer, shape);
+        _renderer.resolveVisibility();
+        break;
+
+    default:
+        for (const Shape& shape : shapes)
+            drawShape(_renderer, shape);
+        return;
+    }
+
+    // Blend the translucent shapes on top of the opaque ones.
+    _renderer.setRenderPass(RenderPass::FORWARD);
+    for (const Shape& shape : shapes)
+        if (!isShapeOpaque(shape)) drawShape(_renderer, shape);
+}
 
-        _renderer.modelPopMat();
+void ShapeManager::drawShape(Renderer& _renderer, const Shape& _shape)
+{
+    // If the shpe's alpha is 0, don't draw it.
+    if (_shape.color.a <= 0.01)
+        return;
+
+    // Trace the shape's index and the number of triangles it drew.
+    PROFILE_NAMED_SCOPE(shapeScope, ProfileZone::SHAPE);
+    PROFILE_SET_ARG(shapeScope, 0, (int)(&_shape - shapes.data()));
+    const int firstTriangle = _renderer.getPipelineStats().trianglesRasterized;
+
+    // Tell the renderer to use the shape's material and texture.
+    _renderer.setMaterial(_shape.material);
+    _renderer.setTexture(textures[_shape.textureID]);
+    _renderer.applyVertexColorToTextures(_shape.applyVertexColor);
+
+    // Disable backface culling for triangles and quads.
+    if (_shape.type == ShapeTypes::TRIANGLE || _shape.type == ShapeTypes::QUAD)
+        _renderer.doBackfaceCulling(false);
+    else
+        _renderer.doBackfaceCulling(true);
+
+    // Translate the shape to its world position.
+    _renderer.modelPushMat();
+    _renderer.modelTranslate(_shape.pos.x, _shape.pos.y, _shape.pos.z);
+    _renderer.modelRotateX(_shape.rot.x);
+    _renderer.modelRotateY(_shape.rot.y);
+    _renderer.modelRotateZ(_shape.rot.z);
+
+    // Draw the shape.
+    switch (_shape.type)
+    {
+    case ShapeTypes::TRIANGLE:
+        _renderer.drawTriangle(_shape.triangleData);
+        break;
+    case ShapeTypes::QUAD:
+        _renderer.drawDividedQuad(_shape.color, _shape.size);
+        break;
+    case ShapeTypes::CUBE:
+        _renderer.drawCube(_shape.color, _shape.size);
+        break;
+    case ShapeTypes::DIVIDED_CUBE:
+        _renderer.drawDividedCube(_shape.color, _shape.size, _shape.subdivisions);
+        break;
+    case ShapeTypes::SPHERE:
+        _renderer.drawSphere(_shape.color, _shape.size, _shape.subdivisions, _shape.subdivisions);
+        break;
+    default: 
+        break;
     }
+
+    _renderer.modelPopMat();
+    PROFILE_SET_ARG(shapeScope, 1, _renderer.getPipelineStats().trianglesRasterized - firstTriangle);
 }
 
+#ifndef HEADLESS
 void ShapeManager::showImGuiControls()
 {
     // Create a vector of c-string texture names to be used by ImGui.
@@ -249,3 +309,4 @@ void ShapeManager::showImGuiControls()
         ImGui::EndGroup();
     }
 }
+#endif
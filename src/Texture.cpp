@@ -2,9 +2,8 @@
 
 #include <cstdio>
 using namespace arithmetic;
-#include <imgui.h>
 
-Color TextureData::getPixelColor(const int& x, const int& y, const float& _alpha)
+Color TextureData::getPixelColor(const int& x, const int& y, const float& _alpha) const
 {
     // Idk why sometimes x and y go to -infinity so I just obliterate the pixel.
     if (x <= -2147483648 || y <= -2147483648) return { 0, 0, 0, 0 };
@@ -23,8 +22,7 @@ Color TextureData::getPixelColor(const int& x, const int& y, const float& _alpha
 
 TextureData loadBmpData(const char* _filename)
 {
-    // Create the texture and the bmp header object.
-    GLuint texture;
+    // Create the bmp header object.
     BmpHeader bmpHeader;
 
     // Open the texture file.
@@ -0,0 +1,91 @@
+#include <string>
+#include <algorithm>
+
+#include "ThreadPool.hpp"
+#include "Profiler.hpp"
+
+using namespace std;
+
+ThreadPool::ThreadPool(int _threadCount)
+{
+    if (_threadCount <= 0)
+        _threadCount = max(1, (int)thread::hardware_concurrency());
+
+    // The calling thread also runs jobs, so spawn one less worker.
+    for (int i = 1; i < _threadCount; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    // Wake the workers up and wait for them to exit.
+    {
+        lock_guard<mutex> lock(jobMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+
+    for (thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::runJobs(const int _workerIndex)
+{
+    // Take job indices until there are none left.
+    for (int i = nextIndex++; i < jobCount; i = nextIndex++)
+        job(i, _workerIndex);
+}
+
+void ThreadPool::workerLoop(const int _workerIndex)
+{
+    profiler::setThreadName("Worker " + to_string(_workerIndex));
+    int seenGeneration = 0;
+
+    while (true)
+    {
+        // Sleep until a new job is posted.
+        {
+            unique_lock<mutex> lock(jobMutex);
+            wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+        }
+
+        runJobs(_workerIndex);
+
+        // Tell the calling thread this worker is done.
+        {
+            lock_guard<mutex> lock(jobMutex);
+            if (--activeWorkers == 0)
+                doneCondition.notify_one();
+        }
+    }
+}
+
+void ThreadPool::parallelFor(const int& _count, const function<void(int, int)>& _job)
+{
+    if (_count <= 0) return;
+
+    // Don't wake the workers up for a single job.
+    if (workers.empty() || _count == 1)
+    {
+        for (int i = 0; i < _count; i++) _job(i, 0);
+        return;
+    }
+
+    // Post the job.
+    {
+        lock_guard<mutex> lock(jobMutex);
+        job           = _job;
+        jobCount      = _count;
+        nextIndex     = 0;
+        activeWorkers = (int)workers.size();
+        generation++;
+    }
+    wakeCondition.notify_all();
+
+    // Work alongside the workers, then wait for them to finish.
+    runJobs(0);
+    unique_lock<mutex> lock(jobMutex);
+    doneCondition.wait(lock, [&] { return activeWorkers == 0; });
+}
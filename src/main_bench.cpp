@@ -0,0 +1,62 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "Benchmark.hpp"
+
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: RasterizerBench [options]\n"
+        "  -w <width>       Framebuffer width (default 1500).\n"
+        "  -h <height>      Framebuffer height (default 950).\n"
+        "  -n <frames>      Number of timed frames per scene (default 100).\n"
+        "  -W <frames>      Number of warmup frames per scene (default 5).\n"
+        "  -o <path>        Output JSON file, '-' writes to stdout (default -).\n"
+        "  -s <scene>       Only run default, spheres, translucent or textured (default all of them).\n"
+        "  -m <mode>        unlit, lit, wireframe or zbuffer (default lit).\n"
+        "  -l <lighting>    phong or blinn (default phong).\n"
+        "  -p <pipeline>    forward, prepass or visibility (default forward).\n"
+        "  -b <backend>     immediate or tiled (default immediate).\n");
+}
+
+int main(int argc, char* argv[])
+{
+    // Prepare the initialization structure.
+    BenchmarkInit init =
+    {
+        {
+            1500, 950,
+            100, 1 / 60.f,
+            "-",
+            ScenePreset::DEFAULT, RenderMode::LIT, LightingMode::PHONG, RenderPipeline::FORWARD, RasterBackend::IMMEDIATE,
+            nullptr, 0, -1,
+            nullptr
+        },
+        5,
+        true
+    };
+
+    // Parse the options.
+    for (int i = 1; i < argc; i += 2)
+    {
+        bool valid = argv[i][0] == '-' && argv[i][1] != '\0' && argv[i][2] == '\0' && i + 1 < argc;
+        if (valid)
+        {
+            switch (argv[i][1])
+            {
+            case 'W': init.warmupCount = atoi(argv[i + 1]); valid = init.warmupCount >= 0; break;
+            case 's': init.allScenes   = false; // Fallthrough.
+            default:  valid = parseHeadlessOption(argv[i][1], argv[i + 1], init.render); break;
+            }
+        }
+        if (!valid)
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    // Run the benchmark.
+    Benchmark benchmark(init);
+    return benchmark.run() ? 0 : 1;
+}
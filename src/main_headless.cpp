@@ -0,0 +1,63 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "HeadlessApp.hpp"
+
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: RasterizerHeadless [options]\n"
+        "  -w <width>       Framebuffer width (default 1500).\n"
+        "  -h <height>      Framebuffer height (default 950).\n"
+        "  -n <frames>      Number of frames to render (default 1).\n"
+        "  -o <path>        Output PPM file, %%d is replaced by the frame index. '-' writes to stdout (default frame%%d.ppm).\n"
+        "  -s <scene>       default, spheres, translucent or textured (default default).\n"
+        "  -m <mode>        unlit, lit, wireframe or zbuffer (default lit).\n"
+        "  -l <lighting>    phong or blinn (default phong).\n"
+        "  -p <pipeline>    forward, prepass or visibility (default forward).\n"
+        "  -b <backend>     immediate or tiled (default immediate).\n"
+        "  -t <path>        Write a Chrome trace (chrome://tracing, ui.perfetto.dev) of the frames.\n"
+        "  -f <frame>       First traced frame (default 0).\n"
+        "  -c <frames>      Number of traced frames (default all of them).\n"
+        "  -S <path>        Write the pipeline statistics of each frame to a CSV file.\n");
+}
+
+int main(int argc, char* argv[])
+{
+    // Prepare the initialization structure.
+    HeadlessInit init =
+    {
+        1500, 950,
+        1, 1 / 60.f,
+        "frame%d.ppm",
+        ScenePreset::DEFAULT, RenderMode::LIT, LightingMode::PHONG, RenderPipeline::FORWARD, RasterBackend::IMMEDIATE,
+        nullptr, 0, -1,
+        nullptr
+    };
+
+    // Parse the options.
+    for (int i = 1; i < argc; i += 2)
+    {
+        bool valid = argv[i][0] == '-' && argv[i][1] != '\0' && argv[i][2] == '\0' && i + 1 < argc;
+        if (valid)
+        {
+            switch (argv[i][1])
+            {
+            case 't': init.tracePath  = argv[i + 1];       break;
+            case 'f': init.traceFirst = atoi(argv[i + 1]); valid = init.traceFirst >= 0; break;
+            case 'c': init.traceCount = atoi(argv[i + 1]); valid = init.traceCount >  0; break;
+            case 'S': init.statsPath  = argv[i + 1];       break;
+            default:  valid = parseHeadlessOption(argv[i][1], argv[i + 1], init); break;
+            }
+        }
+        if (!valid)
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    // Render the frames.
+    HeadlessApp app(init);
+    return app.update() ? 0 : 1;
+}
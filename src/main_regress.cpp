@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "Regression.hpp"
+
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: RasterizerRegress [options]\n"
+        "  -w <width>       Framebuffer width (default 192).\n"
+        "  -h <height>      Framebuffer height (default 120).\n"
+        "  -n <samples>     Number of timed batches of frames of each render, the best is kept (default 5).\n"
+        "  -r <ms>          Shortest duration of a timed batch (default 10).\n"
+        "  -g <directory>   Golden images (default regression/golden).\n"
+        "  -o <directory>   Failing renders and their diff heatmaps (default regression/out).\n"
+        "  -b <file>        Performance baseline (default regression/baseline/<hostname>.txt, created by the first run).\n"
+        "  -e <tolerance>   Largest difference allowed on a channel of a pixel, 0-255 (default 2).\n"
+        "  -t <threshold>   Relative slowdown reported as a regression (default 0.25).\n"
+        "  -u               Replace the golden images and the baseline with the current renders.\n");
+}
+
+int main(int argc, char* argv[])
+{
+    // Prepare the initialization structure.
+    RegressionInit init =
+    {
+        192, 120,
+        "regression/golden", "regression/out", nullptr,
+        2,
+        5, 10.f, 0.25f,
+        false
+    };
+
+    // Parse the options.
+    for (int i = 1; i < argc; i += 2)
+    {
+        bool valid = argv[i][0] == '-' && argv[i][1] != '\0' && argv[i][2] == '\0';
+        if (valid && argv[i][1] == 'u')
+        {
+            init.update = true;
+            i--;
+            continue;
+        }
+        valid = valid && i + 1 < argc;
+        if (valid)
+        {
+            switch (argv[i][1])
+            {
+            case 'w': init.width         = atoi(argv[i + 1]); valid = init.width  > 0;       break;
+            case 'h': init.height        = atoi(argv[i + 1]); valid = init.height > 0;       break;
+            case 'n': init.sampleCount   = atoi(argv[i + 1]); valid = init.sampleCount > 0;   break;
+            case 'r': init.batchMs       = atof(argv[i + 1]); valid = init.batchMs >= 0;      break;
+            case 'g': init.goldenDir     = argv[i + 1];                                       break;
+            case 'o': init.outputDir     = argv[i + 1];                                       break;
+            case 'b': init.baselinePath  = argv[i + 1];                                       break;
+            case 'e': init.tolerance     = atoi(argv[i + 1]); valid = init.tolerance >= 0;    break;
+            case 't': init.perfThreshold = atof(argv[i + 1]); valid = init.perfThreshold > 0; break;
+            default:  valid = false; break;
+            }
+        }
+        if (!valid)
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    // Run the regression test.
+    Regression regression(init);
+    return regression.run() ? 0 : 1;
+}